@@ -0,0 +1,178 @@
+// cache.cc
+//	Routines to manage a cache of disk sectors.  See cache.h for
+//	how the cache is organized, and synchdisk.cc for how it is used.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "debug.h"
+#include "cache.h"
+
+//----------------------------------------------------------------------
+// SectorCache::SectorCache
+// 	Initialize an empty sector cache.  All of the entries start out
+//	unused, on the LRU list, and not on any hash chain.
+//
+//	"size" is the number of sectors the cache can hold
+//----------------------------------------------------------------------
+
+SectorCache::SectorCache(int size)
+{
+    ASSERT(size > 0);
+
+    numEntries = size;
+    entries = new CacheEntry[size];
+    numBuckets = 2 * size;
+    buckets = new CacheEntry *[numBuckets];
+    for (int i = 0; i < numBuckets; i++)
+	buckets[i] = NULL;
+
+    lruHead = lruTail = NULL;
+    for (int i = 0; i < numEntries; i++) {
+	entries[i].sector = -1;
+	entries[i].dirty = FALSE;
+	entries[i].busy = FALSE;
+	entries[i].hashNext = NULL;
+	PushFront(&entries[i]);
+    }
+}
+
+//----------------------------------------------------------------------
+// SectorCache::~SectorCache
+// 	De-allocate the sector cache.
+//----------------------------------------------------------------------
+
+SectorCache::~SectorCache()
+{
+    delete [] entries;
+    delete [] buckets;
+}
+
+//----------------------------------------------------------------------
+// SectorCache::Find
+// 	Return the cache entry holding "sector", or NULL if the sector
+//	is not in the cache.  Does not change the LRU order; the caller
+//	should Touch the entry once it has used it.
+//
+//	"sector" -- the disk sector to look up
+//----------------------------------------------------------------------
+
+CacheEntry *
+SectorCache::Find(int sector)
+{
+    CacheEntry *entry;
+
+    for (entry = buckets[HashValue(sector)]; entry != NULL;
+					entry = entry->hashNext)
+	if (entry->sector == sector)
+	    return entry;
+    return NULL;
+}
+
+//----------------------------------------------------------------------
+// SectorCache::Victim
+// 	Return the least recently used entry that is not busy, or NULL
+//	if every entry in the cache is busy.
+//----------------------------------------------------------------------
+
+CacheEntry *
+SectorCache::Victim()
+{
+    CacheEntry *entry;
+
+    for (entry = lruTail; entry != NULL; entry = entry->prev)
+	if (!entry->busy)
+	    return entry;
+    return NULL;
+}
+
+//----------------------------------------------------------------------
+// SectorCache::Replace
+// 	Take the least recently used entry that is not busy out of the
+//	cache, and rebind it to hold "sector".  The contents of the
+//	returned entry are garbage; the caller must fill them in.  The
+//	entry being replaced must not be dirty.
+//
+//	"sector" -- the disk sector the entry will now hold
+//----------------------------------------------------------------------
+
+CacheEntry *
+SectorCache::Replace(int sector)
+{
+    CacheEntry *entry = Victim();
+    int bucket = HashValue(sector);
+
+    ASSERT(Find(sector) == NULL);
+    ASSERT(entry != NULL && !entry->dirty);
+
+    if (entry->sector != -1)
+	Unhash(entry);
+    entry->sector = sector;
+    entry->hashNext = buckets[bucket];
+    buckets[bucket] = entry;
+    Touch(entry);
+    return entry;
+}
+
+//----------------------------------------------------------------------
+// SectorCache::Touch
+// 	Move an entry to the front of the LRU list, to record that it
+//	has just been used.
+//----------------------------------------------------------------------
+
+void
+SectorCache::Touch(CacheEntry *entry)
+{
+    Unlink(entry);
+    PushFront(entry);
+}
+
+//----------------------------------------------------------------------
+// SectorCache::Unhash
+// 	Take an entry off the hash chain for the sector it holds.
+//----------------------------------------------------------------------
+
+void
+SectorCache::Unhash(CacheEntry *entry)
+{
+    CacheEntry **ptr = &buckets[HashValue(entry->sector)];
+
+    while (*ptr != entry) {
+	ASSERT(*ptr != NULL);
+	ptr = &(*ptr)->hashNext;
+    }
+    *ptr = entry->hashNext;
+    entry->hashNext = NULL;
+}
+
+//----------------------------------------------------------------------
+// SectorCache::Unlink/PushFront
+// 	Maintain the doubly linked LRU list.
+//----------------------------------------------------------------------
+
+void
+SectorCache::Unlink(CacheEntry *entry)
+{
+    if (entry->prev != NULL)
+	entry->prev->next = entry->next;
+    else
+	lruHead = entry->next;
+    if (entry->next != NULL)
+	entry->next->prev = entry->prev;
+    else
+	lruTail = entry->prev;
+}
+
+void
+SectorCache::PushFront(CacheEntry *entry)
+{
+    entry->prev = NULL;
+    entry->next = lruHead;
+    if (lruHead != NULL)
+	lruHead->prev = entry;
+    else
+	lruTail = entry;
+    lruHead = entry;
+}
@@ -0,0 +1,95 @@
+// cache.h
+//	Data structures for a cache of disk sectors kept in main memory.
+//
+//	The file system reads the same few sectors (file headers,
+//	directories, the free map) over and over again.  Rather than going
+//	to the disk every time, SynchDisk keeps a fixed number of recently
+//	used sectors in memory, and only goes to the disk on a miss.
+//
+//	Entries are replaced in LRU order.  A small chained hash table,
+//	keyed by sector number, is used to find the entry holding a sector.
+//
+//	The cache itself does no I/O and no synchronization; it is
+//	only a lookup structure.  The caller (SynchDisk) is responsible
+//	for filling entries from the disk, for writing dirty entries
+//	back before they are replaced, and for mutual exclusion.  While
+//	the caller has I/O outstanding on an entry, it marks it busy;
+//	a busy entry is never chosen for replacement.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+
+#ifndef CACHE_H
+#define CACHE_H
+
+#include "disk.h"
+
+#define CacheSize 	64	// number of sectors kept in the cache
+
+// The following class defines one entry of the sector cache: a copy
+// of the contents of a single disk sector.
+//
+// Internal data structures kept public so that SynchDisk can fill
+// in and copy out the sector contents directly.
+
+class CacheEntry {
+  public:
+    int sector;				// Disk sector held in this entry,
+					// -1 if the entry is unused
+    char data[SectorSize];		// Contents of the sector
+    bool dirty;				// Has the entry been modified since
+					// it was last written to disk?
+    bool busy;				// Is a disk transfer in progress
+					// to or from "data"?
+
+    CacheEntry *prev;			// LRU list, most recently used first
+    CacheEntry *next;
+    CacheEntry *hashNext;		// Next entry in the same hash bucket
+};
+
+// The following class defines the sector cache.  "Find" looks up a
+// sector; "Replace" takes the least recently used entry, and rebinds
+// it to a new sector (the caller must then fill in its contents).
+// "Victim" returns the entry the next Replace will take (the least
+// recently used entry that is not busy), so that the caller can
+// write it back first if it is dirty.
+
+class SectorCache {
+  public:
+    SectorCache(int size);		// Initialize an empty cache with
+					// room for "size" sectors
+    ~SectorCache();			// De-allocate the cache
+
+    CacheEntry *Find(int sector);	// Return the entry holding "sector",
+					// or NULL if it isn't cached
+    CacheEntry *Replace(int sector);	// Evict the least recently used
+					// entry, and rebind it to "sector"
+    void Touch(CacheEntry *entry);	// Mark "entry" most recently used
+    CacheEntry *Victim();		// Entry to be taken by next Replace,
+					// NULL if every entry is busy
+
+    int NumEntries() { return numEntries; }
+    CacheEntry *Entry(int i) { return &entries[i]; }
+					// For walking every entry, e.g.
+					// to write back the dirty ones
+
+  private:
+    int numEntries;			// Number of entries in the cache
+    CacheEntry *entries;		// Storage for the entries
+    CacheEntry *lruHead;		// Most recently used entry
+    CacheEntry *lruTail;		// Least recently used entry
+
+    int numBuckets;			// Number of hash buckets
+    CacheEntry **buckets;		// Hash chains, keyed by sector #
+
+    int HashValue(int sector) { return sector % numBuckets; }
+    void Unhash(CacheEntry *entry);	// Take "entry" off its hash chain
+    void Unlink(CacheEntry *entry);	// Take "entry" off the LRU list
+    void PushFront(CacheEntry *entry);	// Put "entry" at the front of the
+					// LRU list
+};
+
+#endif // CACHE_H
@@ -0,0 +1,178 @@
+// dcache.cc
+//	Routines to manage a cache of path name lookups.  See dcache.h
+//	for how the cache is organized, and FileSystem::LookupPath for
+//	how it is used.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "debug.h"
+#include "dcache.h"
+
+//----------------------------------------------------------------------
+// DentryCache::DentryCache
+// 	Initialize an empty path cache.
+//
+//	"size" is the number of paths the cache can hold
+//----------------------------------------------------------------------
+
+DentryCache::DentryCache(int size)
+{
+    ASSERT(size > 0);
+
+    numEntries = size;
+    entries = new Dentry[size];
+    for (int i = 0; i < numEntries; i++) {
+	entries[i].path[0] = '\0';
+	entries[i].sector = -1;
+	entries[i].lastUsed = 0;
+	entries[i].hashNext = NULL;
+    }
+    numBuckets = 2 * size;
+    buckets = new Dentry *[numBuckets];
+    for (int i = 0; i < numBuckets; i++)
+	buckets[i] = NULL;
+    useCount = 0;
+}
+
+//----------------------------------------------------------------------
+// DentryCache::~DentryCache
+// 	De-allocate the path cache.
+//----------------------------------------------------------------------
+
+DentryCache::~DentryCache()
+{
+    delete [] entries;
+    delete [] buckets;
+}
+
+//----------------------------------------------------------------------
+// DentryCache::Lookup
+// 	Return the sector of the file header "path" leads to, or -1 if
+//	the path is not in the cache.
+//
+//	"path" -- the full path name to look up
+//----------------------------------------------------------------------
+
+int
+DentryCache::Lookup(char *path)
+{
+    Dentry *entry = Find(path);
+
+    if (entry == NULL)
+	return -1;
+    entry->lastUsed = ++useCount;
+    return entry->sector;
+}
+
+//----------------------------------------------------------------------
+// DentryCache::Insert
+// 	Remember that "path" leads to the file header at "sector".
+//	If the cache is full, the least recently used path is dropped.
+//
+//	"path" -- the full path name
+//	"sector" -- the disk sector holding the path's file header
+//----------------------------------------------------------------------
+
+void
+DentryCache::Insert(char *path, int sector)
+{
+    Dentry *entry = Find(path);
+    int bucket;
+
+    if (strlen(path) > MAX_PATH_LEN)
+	return;			// too long to cache
+    if (entry == NULL) {
+	entry = &entries[0];
+	for (int i = 1; i < numEntries && entry->sector != -1; i++)
+	    if (entries[i].sector == -1
+			|| entries[i].lastUsed < entry->lastUsed)
+		entry = &entries[i];
+	if (entry->sector != -1)
+	    Unhash(entry);
+
+	strcpy(entry->path, path);
+	bucket = HashValue(path);
+	entry->hashNext = buckets[bucket];
+	buckets[bucket] = entry;
+    }
+    DEBUG(dbgFile, "Caching path " << path << " at sector " << sector);
+    entry->sector = sector;
+    entry->lastUsed = ++useCount;
+}
+
+//----------------------------------------------------------------------
+// DentryCache::Invalidate
+// 	Forget "path", and every path that goes through it (that is, the
+//	path of every file in it, if it is a directory).
+//
+//	"path" -- the full path name of a file or directory being removed
+//----------------------------------------------------------------------
+
+void
+DentryCache::Invalidate(char *path)
+{
+    int length = strlen(path);
+
+    for (int i = 0; i < numEntries; i++) {
+	if (entries[i].sector != -1
+		&& !strncmp(entries[i].path, path, length)
+		&& (entries[i].path[length] == '\0'
+			|| entries[i].path[length] == '/')) {
+	    Unhash(&entries[i]);
+	    entries[i].sector = -1;
+	}
+    }
+}
+
+//----------------------------------------------------------------------
+// DentryCache::HashValue
+// 	Return the hash bucket "path" belongs in.
+//----------------------------------------------------------------------
+
+int
+DentryCache::HashValue(char *path)
+{
+    unsigned h = 0;
+
+    for (; *path != '\0'; path++)
+	h = h * 31 + (unsigned char) *path;
+    return h % numBuckets;
+}
+
+//----------------------------------------------------------------------
+// DentryCache::Find
+// 	Return the entry holding "path", or NULL if there is none.
+//----------------------------------------------------------------------
+
+Dentry *
+DentryCache::Find(char *path)
+{
+    Dentry *entry;
+
+    for (entry = buckets[HashValue(path)]; entry != NULL;
+					entry = entry->hashNext)
+	if (!strcmp(entry->path, path))
+	    return entry;
+    return NULL;
+}
+
+//----------------------------------------------------------------------
+// DentryCache::Unhash
+// 	Take an entry off the hash chain for the path it holds.
+//----------------------------------------------------------------------
+
+void
+DentryCache::Unhash(Dentry *entry)
+{
+    Dentry **ptr = &buckets[HashValue(entry->path)];
+
+    while (*ptr != entry) {
+	ASSERT(*ptr != NULL);
+	ptr = &(*ptr)->hashNext;
+    }
+    *ptr = entry->hashNext;
+    entry->hashNext = NULL;
+}
@@ -0,0 +1,70 @@
+// dcache.h
+//	Data structures for a cache of path name lookups.
+//
+//	To find the file header of "/t0/bb/f3", the file system has to
+//	read the root directory, then "/t0", then "/t0/bb".  Rather than
+//	doing that on every Open, Create, Remove and List, the file
+//	system remembers which header sector each path it has looked up
+//	(and each leading part of it) led to.  In UNIX terms, this is the
+//	"dentry cache".
+//
+//	Only paths that were found are cached.  When a file or directory
+//	is removed, its path and every path below it must be invalidated,
+//	since the header sectors may be reused for other files.
+//
+//	Entries are replaced in LRU order.  As with the sector cache,
+//	a small chained hash table is used to find the entry for a path.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+
+#ifndef DCACHE_H
+#define DCACHE_H
+
+#include "filesys.h"
+
+#define DentryCacheSize	64	// number of paths kept in the cache
+
+// The following class defines one entry of the path cache.
+
+class Dentry {
+  public:
+    char path[MAX_PATH_LEN + 1];	// Full path name, from the root
+    int sector;				// Where the path's file header is,
+					// -1 if the entry is unused
+    int lastUsed;			// When the entry was last looked
+					// up, for LRU replacement
+    Dentry *hashNext;			// Next entry in the same hash bucket
+};
+
+// The following class defines the path cache.
+
+class DentryCache {
+  public:
+    DentryCache(int size);		// Initialize an empty cache with
+					// room for "size" paths
+    ~DentryCache();			// De-allocate the cache
+
+    int Lookup(char *path);		// Return the header sector for
+					// "path", or -1 if it isn't cached
+    void Insert(char *path, int sector);	// Remember where "path" is
+    void Invalidate(char *path);	// Forget "path" and every path
+					// below it
+
+  private:
+    int numEntries;			// Number of entries in the cache
+    Dentry *entries;			// Storage for the entries
+    int numBuckets;			// Number of hash buckets
+    Dentry **buckets;			// Hash chains, keyed by path
+    int useCount;			// Number of lookups so far; used
+					// to time stamp entries
+
+    int HashValue(char *path);		// Which bucket does "path" go in?
+    Dentry *Find(char *path);		// Entry holding "path", or NULL
+    void Unhash(Dentry *entry);		// Take "entry" off its hash chain
+};
+
+#endif // DCACHE_H
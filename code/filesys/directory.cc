@@ -1,31 +1,87 @@
 // directory.cc 
 //	Routines to manage a directory of file names.
 //
-//	The directory is a table of fixed length entries; each
-//	entry represents a single file, and contains the file name,
-//	and the location of the file header on disk.  The fixed size
-//	of each directory entry means that we have the restriction
-//	of a fixed maximum size for file names.
+//	The directory is a list of variable length entries, packed into
+//	directory blocks; each entry represents a single file, and
+//	contains the file name, and the location of the file header on
+//	disk.  An entry takes only as much space as its name needs, so
+//	that file names can be long (up to FileNameMaxLen characters)
+//	without making every directory bigger.
 //
 //	The constructor initializes an empty directory of a certain size;
 //	we use ReadFrom/WriteBack to fetch the contents of the directory
 //	from disk, and to write back any modifications back to disk.
 //
-//	Also, this implementation has the restriction that the size
-//	of the directory cannot expand.  In other words, once all the
-//	entries in the directory are used, no more files can be created.
+//	The directory blocks are the buckets of a linear hash table.
+//	With N blocks, and 2^i <= N < 2^(i+1), a name whose hash is h
+//	belongs in block h mod 2^(i+1), or, if there is no such block
+//	yet, in block h mod 2^i.  When a name will not fit in its block,
+//	block N - 2^i is split: block N is added, and the entries of
+//	block N - 2^i that now belong in block N are moved there.  So
+//	the directory grows one block at a time, as it needs to, and
+//	never has to be rehashed all at once.  A directory does not
+//	shrink when files are removed.
+//
+//	Each entry keeps the hash of its name, so splitting a block does
+//	not rehash any names, and two names are only compared if their
+//	hashes match.
 //
 // Copyright (c) 1992-1993 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation 
 // of liability and disclaimer of warranty provisions.
 
 #include "copyright.h"
+#include "debug.h"
+#include "main.h"
 #include "utility.h"
 #include "filehdr.h"
+#include "hdrtable.h"
 #include "filesys.h"
 #include "directory.h"
 
-#define DirectorySector 1
+//----------------------------------------------------------------------
+// HashName
+// 	Return the hash of a file name, as kept in its directory entry.
+//	Which block a name goes in depends on the low bits of its hash,
+//	so every character of the name should affect them (FNV-1a).
+//----------------------------------------------------------------------
+
+static unsigned
+HashName(char *name)
+{
+    unsigned h = 2166136261u;
+
+    for (int i = 0; i < FileNameMaxLen && name[i] != '\0'; i++) {
+	h ^= (unsigned char) name[i];
+	h *= 16777619;
+    }
+    return h;
+}
+
+//----------------------------------------------------------------------
+// FirstOffset, EmptyBlock
+// 	The entries of the first block come after the DirectoryInfo;
+//	those of the others start at the start of the block.  An empty
+//	block holds a single unused entry, taking up all of that space.
+//----------------------------------------------------------------------
+
+static int
+FirstOffset(int bucket)
+{
+    return (bucket == 0) ? DirInfoSize : 0;
+}
+
+static char *
+EmptyBlock(int bucket)
+{
+    char *block = new char[DirBlockSize];
+    DirectoryEntry *entry = (DirectoryEntry *) &block[FirstOffset(bucket)];
+
+    memset(block, 0, DirBlockSize);	// keep valgrind happy
+    entry->sector = -1;
+    entry->length = DirBlockSize - FirstOffset(bucket);
+    return block;
+}
 
 //----------------------------------------------------------------------
 // Directory::Directory
@@ -34,19 +90,22 @@
 //	is all we need, but otherwise, we need to call FetchFrom in order
 //	to initialize it from disk.
 //
-//	"size" is the number of entries in the directory
+//	"size" is the number of directory blocks in the directory
 //----------------------------------------------------------------------
 
 Directory::Directory(int size)
 {
-    table = new DirectoryEntry[size];
-	
-	// MP4 mod tag
-	memset(table, 0, sizeof(DirectoryEntry) * size);  // dummy operation to keep valgrind happy
-	
-    tableSize = size;
-    for (int i = 0; i < tableSize; i++)
-	table[i].inUse = FALSE;
+    ASSERT(size > 0);
+
+    file = NULL;
+    numBuckets = maxBlocks = size;
+    blocks = new char *[size];
+    dirty = new bool[size];
+    for (int i = 0; i < numBuckets; i++) {
+	blocks[i] = EmptyBlock(i);
+	dirty[i] = TRUE;		// not on disk yet
+    }
+    ((DirectoryInfo *) blocks[0])->numBuckets = numBuckets;
 }
 
 //----------------------------------------------------------------------
@@ -56,12 +115,47 @@ Directory::Directory(int size)
 
 Directory::~Directory()
 { 
-    delete [] table;
+    for (int i = 0; i < maxBlocks; i++)
+	if (blocks[i] != NULL)
+	    delete [] blocks[i];
+    delete [] blocks;
+    delete [] dirty;
 } 
 
+//----------------------------------------------------------------------
+// Directory::Resize
+// 	Make sure "blocks" and "dirty" have room for "size" blocks.
+//	They are doubled in size, so that growing a directory one block
+//	at a time does not copy them each time.
+//----------------------------------------------------------------------
+
+void
+Directory::Resize(int size)
+{
+    char **oldBlocks = blocks;
+    bool *oldDirty = dirty;
+    int oldMax = maxBlocks;
+
+    if (size <= maxBlocks)
+	return;
+    while (maxBlocks < size)
+	maxBlocks *= 2;
+    blocks = new char *[maxBlocks];
+    dirty = new bool[maxBlocks];
+    for (int i = 0; i < maxBlocks; i++) {
+	blocks[i] = (i < oldMax) ? oldBlocks[i] : NULL;
+	dirty[i] = (i < oldMax) ? oldDirty[i] : FALSE;
+    }
+    delete [] oldBlocks;
+    delete [] oldDirty;
+}
+
 //----------------------------------------------------------------------
 // Directory::FetchFrom
-// 	Read the contents of the directory from disk.
+// 	Read the contents of the directory from disk.  Only the first
+//	block, which holds the DirectoryInfo, is read here; the others
+//	are read as they are needed (see GetBlock).  A small directory
+//	has just the one block anyway.
 //
 //	"file" -- file containing the directory contents
 //----------------------------------------------------------------------
@@ -69,12 +163,22 @@ Directory::~Directory()
 void
 Directory::FetchFrom(OpenFile *file)
 {
-    (void) file->ReadAt((char *)table, tableSize * sizeof(DirectoryEntry), 0);
+    for (int i = 0; i < maxBlocks; i++)
+	if (blocks[i] != NULL) {
+	    delete [] blocks[i];
+	    blocks[i] = NULL;
+	}
+    this->file = file;
+    numBuckets = 1;
+    numBuckets = ((DirectoryInfo *) GetBlock(0))->numBuckets;
+    ASSERT(numBuckets > 0);
+    Resize(numBuckets);
 }
 
 //----------------------------------------------------------------------
 // Directory::WriteBack
-// 	Write any modifications to the directory back to disk
+// 	Write any modifications to the directory back to disk.  Only
+//	the blocks that have changed are written.
 //
 //	"file" -- file to contain the new directory contents
 //----------------------------------------------------------------------
@@ -82,24 +186,202 @@ Directory::FetchFrom(OpenFile *file)
 void
 Directory::WriteBack(OpenFile *file)
 {
-    (void) file->WriteAt((char *)table, tableSize * sizeof(DirectoryEntry), 0);
+    this->file = file;
+    for (int i = 0; i < numBuckets; i++)
+	if (blocks[i] != NULL && dirty[i]) {
+	    (void) file->WriteAt(blocks[i], DirBlockSize, i * DirBlockSize);
+	    dirty[i] = FALSE;
+	}
 }
 
 //----------------------------------------------------------------------
-// Directory::FindIndex
-// 	Look up file name in directory, and return its location in the table of
-//	directory entries.  Return -1 if the name isn't in the directory.
+// Directory::GetBlock
+// 	Return a directory block, reading it from disk the first time
+//	it is asked for.
 //
-//	"name" -- the file name to look up
+//	"bucket" -- which block
+//----------------------------------------------------------------------
+
+char *
+Directory::GetBlock(int bucket)
+{
+    ASSERT(bucket >= 0 && bucket < numBuckets);
+    if (blocks[bucket] == NULL) {
+	ASSERT(file != NULL);
+	blocks[bucket] = new char[DirBlockSize];
+	(void) file->ReadAt(blocks[bucket], DirBlockSize,
+						bucket * DirBlockSize);
+	dirty[bucket] = FALSE;
+    }
+    return blocks[bucket];
+}
+
+//----------------------------------------------------------------------
+// Directory::BucketOf
+// 	Return the block a name whose hash is "hash" belongs in.
 //----------------------------------------------------------------------
 
 int
-Directory::FindIndex(char *name)
+Directory::BucketOf(unsigned hash)
+{
+    unsigned low = 1;
+
+    while (low * 2 <= (unsigned) numBuckets)
+	low *= 2;			// largest power of 2 <= numBuckets
+    if ((hash & (2 * low - 1)) < (unsigned) numBuckets)
+	return hash & (2 * low - 1);
+    return hash & (low - 1);		// that block has not been split yet
+}
+
+//----------------------------------------------------------------------
+// Directory::Split
+// 	Add a block to the directory, and move into it the entries
+//	of the block it is split from that now belong in it.
+//
+//	Only the blocks in memory change.  The file is grown by Add,
+//	once it knows the new name fits (see Grow), so that an Add that
+//	fails leaves nothing changed on disk.
+//----------------------------------------------------------------------
+
+void
+Directory::Split()
+{
+    int low = 1, from, to = numBuckets;
+    DirectoryEntry *entry, *moved;
+    char *block;
+
+    ASSERT(file != NULL);
+    while (low * 2 <= numBuckets)
+	low *= 2;
+    from = numBuckets - low;
+
+    Resize(to + 1);
+    blocks[to] = EmptyBlock(to);
+    dirty[to] = TRUE;
+
+    block = GetBlock(from);
+    numBuckets++;
+    ((DirectoryInfo *) GetBlock(0))->numBuckets = numBuckets;
+    dirty[0] = TRUE;
+
+    for (int offset = FirstOffset(from); offset < DirBlockSize;
+						offset += entry->length) {
+	entry = (DirectoryEntry *) &block[offset];
+	if (entry->sector != -1 && BucketOf(entry->hash) == to) {
+	    moved = AddEntry(to, entry->name, entry->hash, entry->sector,
+							entry->isDir);
+	    ASSERT(moved != NULL);	// they all fitted in "from"
+	    RemoveEntry(from, entry);
+	}
+    }
+}
+
+//----------------------------------------------------------------------
+// Directory::Grow
+// 	Make the directory's file long enough to hold every block, by
+//	writing the blocks from "first" on that are past its end.  They
+//	are written with one WriteAt, so the file is grown all at once
+//	or not at all.  Return FALSE, leaving the file as it was, if
+//	there is no room on disk.
+//
+//	"first" -- the first block that is new since the directory was
+//		read in
+//----------------------------------------------------------------------
+
+bool
+Directory::Grow(int first)
+{
+    int length;
+    char *buf;
+    bool grown;
+
+    ASSERT(file != NULL);
+    first = max(first, file->Length() / DirBlockSize);
+    if (first >= numBuckets)
+	return TRUE;			// long enough already
+    length = (numBuckets - first) * DirBlockSize;
+    buf = new char[length];
+    for (int i = first; i < numBuckets; i++)
+	bcopy(blocks[i], &buf[(i - first) * DirBlockSize], DirBlockSize);
+    grown = (file->WriteAt(buf, length, first * DirBlockSize) == length);
+    if (grown)
+	for (int i = first; i < numBuckets; i++)
+	    dirty[i] = FALSE;		// written just now
+    delete [] buf;
+    return grown;
+}
+
+//----------------------------------------------------------------------
+// Directory::NextEntry
+// 	Return the first entry in use after "entry", reading in the
+//	blocks that follow as need be, or NULL if there is none.  If
+//	"entry" is NULL, return the first entry in use in the directory,
+//	starting from block "*bucket".  "*bucket" is set to the block
+//	the entry returned is in.
+//
+//	Once all of a block has been stepped through, it is let go of,
+//	unless it has changed, so that walking through a directory of
+//	any size holds only one block in memory.  Since the blocks are
+//	read in order, the ones after are read ahead (see
+//	OpenFile::ReadAt).
+//----------------------------------------------------------------------
+
+DirectoryEntry *
+Directory::NextEntry(int *bucket, DirectoryEntry *entry)
+{
+    int offset;
+    char *block;
+
+    if (entry == NULL)
+	offset = FirstOffset(*bucket);
+    else
+	offset = (char *) entry - blocks[*bucket] + entry->length;
+
+    while (*bucket < numBuckets) {
+	block = GetBlock(*bucket);
+	for (; offset < DirBlockSize; offset += entry->length) {
+	    entry = (DirectoryEntry *) &block[offset];
+	    ASSERT(entry->length >= DirEntryHeaderSize);
+	    if (entry->sector != -1)
+		return entry;
+	}
+	if (!dirty[*bucket]) {
+	    delete [] blocks[*bucket];
+	    blocks[*bucket] = NULL;
+	}
+	(*bucket)++;
+	offset = FirstOffset(*bucket);
+    }
+    return NULL;
+}
+
+//----------------------------------------------------------------------
+// Directory::FindEntry
+// 	Look up file name in directory, and return its directory entry.
+//	Return NULL if the name isn't in the directory.  Only the one
+//	block the name belongs in is looked at.
+//
+//	"name" -- the file name to look up
+//	"bucket" -- set to the block the name belongs in
+//----------------------------------------------------------------------
+
+DirectoryEntry *
+Directory::FindEntry(char *name, int *bucket)
 {
-    for (int i = 0; i < tableSize; i++)
-        if (table[i].inUse && !strncmp(table[i].name, name, FileNameMaxLen))
-	    return i;
-    return -1;		// name not in directory
+    unsigned hash = HashName(name);
+    DirectoryEntry *entry;
+    char *block;
+
+    *bucket = BucketOf(hash);
+    block = GetBlock(*bucket);
+    for (int offset = FirstOffset(*bucket); offset < DirBlockSize;
+						offset += entry->length) {
+	entry = (DirectoryEntry *) &block[offset];
+	if (entry->sector != -1 && entry->hash == hash &&
+			!strncmp(entry->name, name, FileNameMaxLen))
+	    return entry;
+    }
+    return NULL;		// name not in directory
 }
 
 //----------------------------------------------------------------------
@@ -114,71 +396,108 @@ Directory::FindIndex(char *name)
 int
 Directory::Find(char *name)
 {
-    int i = FindIndex(name);
-    if (i != -1)
-	return table[i].sector;
+    int bucket;
+    DirectoryEntry *entry = FindEntry(name, &bucket);
+
+    if (entry != NULL)
+	return entry->sector;
     return -1;
 }
 
-int 
-Directory::SearchPath(char *name, int offset)
+//----------------------------------------------------------------------
+// Directory::AddEntry
+// 	Put an entry for a file into a directory block, in the first
+//	unused entry, or free space at the end of an entry, that is big
+//	enough for it.  Return the new entry, or NULL if the block has
+//	no room for it.
+//
+//	"bucket" -- the block to put the entry in
+//	"name", "hash" -- the name of the file, and its hash
+//	"sector" -- the disk sector containing the file's header
+//	"isDir" -- is the file a directory?
+//----------------------------------------------------------------------
+
+DirectoryEntry *
+Directory::AddEntry(int bucket, char *name, unsigned hash, int sector,
+								bool isDir)
 {
-    int i, j;
-    int sector = -1, flag = 0; // flag to check wheter it has one more level of subdirectory
-    char filename[FileNameMaxLen + 1];
-    Directory *directory;
-    
-    // root
-    if(name[1] == '\0')
-        return DirectorySector;
-
-    // Start string checking at [offset]
-    for(i = 1; name[i + offset]; i++) {
-        // It has more level
-        if(name[i + offset] == '/') {
-            for(j = 0; j < i; j++)
-                filename[j] = name[j + offset];
-            
-            filename[j] = '\0';
-            flag = 1;
-            break;
-        }
-    }
-        
-    if(!flag) {
-        // If it's in the deepest level. 
-        for(j = 0; name[j + offset]; j++)
-            filename[j] = name[j + offset];
-        filename[j] = '\0';
-        // It's the final level. Find if it is at here.
-        return Find(filename);
+    int nameLength = strlen(name);
+    int size = DirEntrySize(nameLength);
+    char *block = GetBlock(bucket);
+    DirectoryEntry *entry, *newEntry;
+    int used;
+
+    for (int offset = FirstOffset(bucket); offset < DirBlockSize;
+						offset += entry->length) {
+	entry = (DirectoryEntry *) &block[offset];
+	used = (entry->sector == -1) ? 0 : DirEntrySize(entry->nameLength);
+	if (entry->length - used < size)
+	    continue;
+
+	if (used > 0) {			// split off the free space
+	    newEntry = (DirectoryEntry *) &block[offset + used];
+	    newEntry->length = entry->length - used;
+	    entry->length = used;
+	    entry = newEntry;
+	}
+	entry->sector = sector;
+	entry->hash = hash;
+	entry->nameLength = nameLength;
+	entry->isDir = isDir;
+	strcpy(entry->name, name);
+	dirty[bucket] = TRUE;
+	return entry;
     }
-    
-    sector = Find(filename);
-
-    if(sector == -1) 
-        return sector;
-    
-    // It's not the deepest level, so it should be a directory, recursively search 
-    directory = new Directory(DirectoryFileSize);
-    OpenFile* dir = new OpenFile(sector);
-    directory->FetchFrom(dir);
-    sector = directory->SearchPath(name, i + offset);
-
-    delete directory;
-    delete dir;
-    
-    return sector;
+    return NULL;
+}
 
+//----------------------------------------------------------------------
+// Directory::RemoveEntry
+// 	Take an entry out of a directory block.  The space it took up
+//	is given to the entry before it; if there is none, the entry is
+//	just marked unused.  The entry itself is left as it was in
+//	memory, so a caller stepping through the block can still step
+//	past it.
+//
+//	"bucket" -- the block the entry is in
+//	"entry" -- the entry to remove
+//----------------------------------------------------------------------
 
+void
+Directory::RemoveEntry(int bucket, DirectoryEntry *entry)
+{
+    char *start = &blocks[bucket][FirstOffset(bucket)];
+    DirectoryEntry *prev;
+
+    if ((char *) entry == start)
+	entry->sector = -1;
+    else {
+	prev = (DirectoryEntry *) start;
+	while ((char *) prev + prev->length != (char *) entry)
+	    prev = (DirectoryEntry *) ((char *) prev + prev->length);
+	prev->length += entry->length;
+    }
+    dirty[bucket] = TRUE;
 }
 
 //----------------------------------------------------------------------
 // Directory::Add
 // 	Add a file into the directory.  Return TRUE if successful;
-//	return FALSE if the file name is already in the directory, or if
-//	the directory is completely full, and has no more space for
-//	additional file names.
+//	return FALSE if the file name is already in the directory, if
+//	it is too long, or if there is no more space on disk for the
+//	directory to grow.
+//
+//	If the block the name belongs in is full, the directory is
+//	grown (see Split) until it is not.  If the directory has doubled
+//	in size and the block is still full, there are too many names
+//	with the same hash, and we give up.  Only once the name is in
+//	is the file made longer, so if Add fails, nothing on disk has
+//	changed.  (The caller throws away the Directory.)
+//
+//	Each split changes two blocks, and the first, so an Add that
+//	splits many of them would make a transaction too big for the
+//	log; FileSystem::Create first does all but the last MaxSplits
+//	of them itself (see FileSystem::MakeRoom).
 //
 //	"name" -- the name of the file being added
 //	"newSector" -- the disk sector containing the added file's header
@@ -187,18 +506,62 @@ Directory::SearchPath(char *name, int offset)
 bool
 Directory::Add(char *name, int newSector, bool isDir)
 { 
-    if (FindIndex(name) != -1)
+    unsigned hash = HashName(name);
+    int bucket, oldBuckets = numBuckets;
+
+    if ((int) strlen(name) > FileNameMaxLen || FindEntry(name, &bucket) != NULL)
 	return FALSE;
     
-    for (int i = 0; i < tableSize; i++)
-        if (!table[i].inUse) {
-            table[i].inUse = TRUE;
-            strncpy(table[i].name, name, FileNameMaxLen); 
-            table[i].sector = newSector;
-            table[i].isDir = isDir;
-        return TRUE;
-	}
-    return FALSE;	// no space.  Fix when we have extensible files.
+    while (AddEntry(BucketOf(hash), name, hash, newSector, isDir) == NULL) {
+	if (numBuckets == 2 * oldBuckets)
+	    return FALSE;
+	Split();
+    }
+    return Grow(oldBuckets);
+}
+
+//----------------------------------------------------------------------
+// Directory::SplitsFor
+// 	Return how many blocks Add would have to split to make room for
+//	"name", or -1 if even that would not (see Add).  The splits,
+//	and the name, are made in memory only, to count them; the caller
+//	reads the directory back in (or throws it away) afterwards.
+//
+//	"name" -- the name of the file to be added
+//----------------------------------------------------------------------
+
+int
+Directory::SplitsFor(char *name)
+{
+    unsigned hash = HashName(name);
+    int oldBuckets = numBuckets;
+
+    while (AddEntry(BucketOf(hash), name, hash, 0, FALSE) == NULL) {
+	if (numBuckets == 2 * oldBuckets)
+	    return -1;
+	Split();
+    }
+    return numBuckets - oldBuckets;
+}
+
+//----------------------------------------------------------------------
+// Directory::Expand
+// 	Split the next "numSplits" blocks, and make the file long enough
+//	for the new ones.  Return FALSE, leaving the file as it was, if
+//	there is no room on disk.  The blocks that were split are written
+//	by WriteBack.
+//
+//	"numSplits" -- how many blocks to split
+//----------------------------------------------------------------------
+
+bool
+Directory::Expand(int numSplits)
+{
+    int oldBuckets = numBuckets;
+
+    for (int i = 0; i < numSplits; i++)
+	Split();
+    return Grow(oldBuckets);
 }
 
 //----------------------------------------------------------------------
@@ -212,11 +575,12 @@ Directory::Add(char *name, int newSector, bool isDir)
 bool
 Directory::Remove(char *name)
 { 
-    int i = FindIndex(name);
+    int bucket;
+    DirectoryEntry *entry = FindEntry(name, &bucket);
 
-    if (i == -1)
+    if (entry == NULL)
 	return FALSE; 		// name not in directory
-    table[i].inUse = FALSE;
+    RemoveEntry(bucket, entry);
     return TRUE;	
 }
 
@@ -229,6 +593,8 @@ void
 Directory::List(char *from, bool recur)
 {
    bool free = false;   
+   DirectoryEntry *entry;
+   int bucket = 0;
    
    if(from == NULL) {
        // It's from root, allocate for it
@@ -237,24 +603,25 @@ Directory::List(char *from, bool recur)
        free = true;
    }
    
-   for (int i = 0; i < tableSize; i++)
-	if (table[i].inUse) {
+   for (entry = NextEntry(&bucket, NULL); entry != NULL;
+					entry = NextEntry(&bucket, entry)) {
         printf("%s", from);
-	    printf("%s ", table[i].name);
+	    printf("%s ", entry->name);
     
-        if(table[i].isDir)
+        if(entry->isDir)
             printf("D\n");
         else
             printf("F\n");
 
         // recursively traverse
-        if(recur && table[i].isDir) {
-            char path[MAX_PATH_LEN];
+        if(recur && entry->isDir) {
+            char path[MAX_PATH_LEN + 1];
             
             strncpy(path, from, MAX_PATH_LEN);
-            strncat(path, table[i].name, FileNameMaxLen);
-            Directory *directory = new Directory(DirectoryFileSize);
-            OpenFile *file = new OpenFile(table[i].sector);
+            path[MAX_PATH_LEN] = '\0';
+            strncat(path, entry->name, MAX_PATH_LEN - strlen(path));
+            Directory *directory = new Directory(NumDirBlocks);
+            OpenFile *file = new OpenFile(entry->sector);
             directory->FetchFrom(file);
             directory->List(path,recur);
 
@@ -276,56 +643,80 @@ Directory::List(char *from, bool recur)
 void
 Directory::Print()
 { 
-    FileHeader *hdr = new FileHeader;
+    FileHeader *hdr;
+    DirectoryEntry *entry;
+    int bucket = 0;
 
     printf("Directory contents:\n");
-    for (int i = 0; i < tableSize; i++)
-	if (table[i].inUse) {
-	    printf("Name: %s, Sector: %d\n", table[i].name, table[i].sector);
-	    hdr->FetchFrom(table[i].sector);
-	    hdr->Print();
-	}
+    for (entry = NextEntry(&bucket, NULL); entry != NULL;
+					entry = NextEntry(&bucket, entry)) {
+	printf("Name: %s, Sector: %d\n", entry->name, entry->sector);
+	hdr = kernel->headerTable->Acquire(entry->sector);
+	hdr->Print();
+	kernel->headerTable->Release(entry->sector);
+    }
     printf("\n");
-    delete hdr;
 }
 
+//----------------------------------------------------------------------
+// Directory::Destroy
+// 	Remove every file in the directory, and everything in the
+//	directories in it, returning their sectors to "freeMap".
+//
+//	The directory itself is about to be removed, so its entries are
+//	left as they are, and its blocks are not written back; that
+//	keeps the transaction removing a big directory down to the
+//	bitmap and the parent directory, and lets NextEntry let go of
+//	each block once it is done with it.
+//
+//	A file that is still open can't be removed, since its OpenFiles
+//	share its header (see hdrtable.h).  If one is found, return FALSE;
+//	the caller must then Revert "freeMap".
+//
+//	"freeMap" -- the bit map of free disk sectors
+//	"path" -- the full path name of the directory
+//----------------------------------------------------------------------
+
 bool
-Directory::Destroy(PersistentBitmap *freeMap, char *path, OpenFile *file)
+Directory::Destroy(PersistentBitmap *freeMap, char *path)
 {
     FileHeader *fileHdr;
+    DirectoryEntry *entry;
+    int bucket = 0;
 
-    // Loop through table to remove all file.
-    for(int i = 0; i < tableSize; i++) {
-        if(table[i].inUse) {
+    // Loop through the entries to remove all file.
+    for (entry = NextEntry(&bucket, NULL); entry != NULL;
+					entry = NextEntry(&bucket, entry)) {
    
-            if(table[i].isDir) {
+            if (kernel->headerTable->IsHeld(entry->sector))
+                return FALSE;		// still open
+            if(entry->isDir) {
                 // It is a directory, remove it recursively
                 char tarPath[MAX_PATH_LEN + 1];
-                OpenFile *tarDir = new OpenFile(table[i].sector);
+                OpenFile *tarDir = new OpenFile(entry->sector);
                 Directory *directory;
+                bool destroyed;
                 OPENDIR(directory, tarDir);
                 
                 strncpy(tarPath, path, MAX_PATH_LEN);
-                strncat(tarPath, table[i].name, FileNameMaxLen);
-                directory->Destroy(freeMap, tarPath, tarDir);                           
+                tarPath[MAX_PATH_LEN] = '\0';
+                strncat(tarPath, entry->name, MAX_PATH_LEN - strlen(tarPath));
+                destroyed = directory->Destroy(freeMap, tarPath);
                 // prevent leak
                 delete tarDir;
                 delete directory;
+                if (!destroyed)
+                    return FALSE;
             }
 
-            // remove file from table and idsk.
+            // remove file from disk
             fileHdr = new FileHeader;
-            fileHdr->FetchFrom(table[i].sector);
+            fileHdr->FetchFrom(entry->sector);
             fileHdr->Deallocate(freeMap);
-            freeMap->Clear(table[i].sector);
-            Remove(table[i].name);
+            freeMap->Clear(entry->sector);
            
             delete fileHdr;
-        }
     }
-    
-    // write back all change in the directory
-    WriteBack(file);
     return TRUE;
 }
 
@@ -18,28 +18,67 @@
 #define DIRECTORY_H
 
 #include "openfile.h"
+#include "filesys.h"
 
-#define FileNameMaxLen 		9	// for simplicity, we assume 
-					// file names are <= 9 characters long
+#define FileNameMaxLen 		MAX_FILENAME_LENGTH
+					// longest file name, counting its
+					// leading '/'
+
+// A directory is made of directory blocks, each a few sectors long,
+// so that even an entry with the longest name fits in one block.
+
+#define DirBlockSectors		4
+#define DirBlockSize		(DirBlockSectors * SectorSize)
+#define MaxSplits		2	// Most blocks one transaction
+					// splits (see FileSystem::MakeRoom)
+#define DirEntryHeaderSize	12	// Bytes in an entry before the name
+#define DirEntrySize(n)		((int) (divRoundUp(DirEntryHeaderSize + \
+				    (n) + 1, sizeof(int)) * sizeof(int)))
+					// Bytes an entry for a name of
+					// "n" characters takes up
 
 // The following class defines a "directory entry", representing a file
 // in the directory.  Each entry gives the name of the file, and where
 // the file's header is to be found on disk.
 //
+// Entries are of variable length: only as much of "name" as the name
+// needs is stored.  The entries in a directory block follow one
+// another up to the end of the block, each "length" bytes long; the
+// part of an entry after its name is free space, where new entries
+// can go.  When a file is removed, its entry is taken into the one
+// before it, or, at the start of a block, just marked unused.
+//
+// Each entry also holds a hash of its name, so that names are only
+// compared if their hashes are the same, and so that the entries of a
+// block can be split without rehashing their names.
+//
 // Internal data structures kept public so that Directory operations can
 // access them directly.
 
 class DirectoryEntry {
   public:
-    bool inUse;				// Is this directory entry in use?
     int sector;				// Location on disk to find the 
-					//   FileHeader for this file 
+					//   FileHeader for this file, -1
+					//   if the entry is not in use
+    unsigned hash;			// Hash of "name"
+    unsigned short length;		// Bytes from this entry to the next
+    unsigned char nameLength;		// Number of characters in "name"
+    bool isDir;
     char name[FileNameMaxLen + 1];	// Text name for file, with +1 for 
-					// the trailing '\0'
+					// the trailing '\0'; only the first
+					// nameLength + 1 bytes are stored
+};
 
-    bool isDir;
+// The following class defines the information kept at the start of
+// the first directory block, before its entries.
+
+class DirectoryInfo {
+  public:
+    int numBuckets;			// Number of directory blocks in use
 };
 
+#define DirInfoSize		((int) sizeof(DirectoryInfo))
+
 // The following class defines a UNIX-like "directory".  Each entry in
 // the directory describes a file, and where to find it on disk.
 //
@@ -48,12 +87,23 @@ class DirectoryEntry {
 //
 // The constructor initializes a directory structure in memory; the
 // FetchFrom/WriteBack operations shuffle the directory information
-// from/to disk. 
+// from/to disk.  FetchFrom reads only the first directory block,
+// which holds the DirectoryInfo; each other block is read the first
+// time it is needed, and WriteBack only writes the blocks that have
+// changed.  List, Print and Destroy step through the blocks in order,
+// letting go of each one as they finish with it.
+//
+// The directory blocks are the buckets of a hash table (linear
+// hashing): the hash of a name picks the one block the name can be
+// in, so looking up a name reads that block only, however big the
+// directory is.  When the block a new name belongs in is full, the
+// directory grows by one block, and the entries of one existing block
+// are split between it and the new one.
 
 class Directory {
   public:
     Directory(int size); 		// Initialize an empty directory
-					// with space for "size" files
+					// of "size" directory blocks
     ~Directory();			// De-allocate the directory
 
     void FetchFrom(OpenFile *file);  	// Init directory contents from disk
@@ -62,9 +112,12 @@ class Directory {
 
     int Find(char *name);		// Find the sector number of the 
 					// FileHeader for file: "name"
-    int SearchPath(char *name, int offset);
 
     bool Add(char *name, int newSector, bool isDir);  // Add a file name into the directory
+    int SplitsFor(char *name);		// How many blocks Add must split
+					// to make room for "name"
+    bool Expand(int numSplits);		// Split that many blocks, and
+					// grow the file to match
 
     bool Remove(char *name);		// Remove a file from the directory
 
@@ -73,22 +126,50 @@ class Directory {
     void Print();			// Verbose print of the contents
 					//  of the directory -- all the file
 					//  names and their contents.
-    bool Destroy(PersistentBitmap *freeMap, char *path, OpenFile *file);
+    bool Destroy(PersistentBitmap *freeMap, char *path);
+					// Remove everything in the directory;
+					// FALSE if something in it is open
   private:
   
 	/*
 		MP4 Hint:
 		Directory is actually a "file", be careful of how it works with OpenFile and FileHdr.
-		Disk part: table
-		In-core part: tableSize
+		Disk part: the DirectoryInfo, then the blocks
+		In-core part: file, maxBlocks, dirty
 	*/
   
-    int tableSize;			// Number of directory entries
-    DirectoryEntry *table;		// Table of pairs: 
-					// <file name, file header location> 
-
-    int FindIndex(char *name);		// Find the index into the directory 
-					//  table corresponding to "name"
+    OpenFile *file;			// The directory's file, once it has
+					// been read or written
+    int numBuckets;			// Number of directory blocks in use
+    int maxBlocks;			// Size of "blocks" and "dirty"
+    char **blocks;			// The directory blocks read so far;
+					// NULL for those not read yet
+    bool *dirty;			// Which blocks have changed since
+					// they were read from disk
+
+    char *GetBlock(int bucket);		// Return a block, reading it from
+					//  disk if need be
+    int BucketOf(unsigned hash);	// Which block a name with "hash"
+					//  belongs in
+    void Split();			// Grow the directory by one block,
+					//  in memory
+    bool Grow(int first);		// Make the file long enough for
+					//  the blocks from "first" on
+    void Resize(int size);		// Make room for "size" blocks in
+					//  "blocks" and "dirty"
+
+    DirectoryEntry *FindEntry(char *name, int *bucket);
+					// Find the directory entry
+					//  corresponding to "name"
+    DirectoryEntry *AddEntry(int bucket, char *name, unsigned hash,
+					int sector, bool isDir);
+					// Put an entry in a block, if
+					//  there is room
+    void RemoveEntry(int bucket, DirectoryEntry *entry);
+					// Take an entry out of a block
+    DirectoryEntry *NextEntry(int *bucket, DirectoryEntry *entry);
+					// The entry in use after "entry",
+					//  or the first if "entry" is NULL
 };
 
 #endif // DIRECTORY_H
@@ -3,12 +3,21 @@
 //	would be called the i-node).
 //
 //	The file header is used to locate where on disk the 
-//	file's data is stored.  We implement this as a fixed size
-//	table of pointers -- each entry in the table points to the 
-//	disk sector containing that portion of the file data
-//	(in other words, there are no indirect or doubly indirect 
-//	blocks). The table size is chosen so that the file header
-//	will be just big enough to fit in one disk sector, 
+//	file's data is stored.  We implement this as a list of
+//	extents -- each entry in the list gives the first disk sector
+//	and the length of a run of consecutive sectors holding that
+//	portion of the file data.  The first few extents fit in the
+//	header sector itself; if a file needs more, they are stored
+//	in extent blocks, whose sector numbers are kept in the header.
+//
+//	A file of up to InlineSize bytes has no data sectors; its data
+//	is kept in the header sector, where the extents would go.  Most
+//	files are small, so most files can be read with one disk read,
+//	and written without allocating anything.
+//
+//	The extent blocks are only read in when one of their extents is
+//	needed.  Opening a file, or reading the start of it, costs one
+//	disk read however large the file is.
 //
 //      Unlike in a real system, we do not keep track of file permissions, 
 //	ownership, last modification date, etc., in the file header. 
@@ -29,6 +38,51 @@
 #include "synchdisk.h"
 #include "main.h"
 
+// The in-core copies of the extent blocks are all the same size, and
+// come and go with every open and close of a large file.  Rather than
+// going to new and delete each time, they are carved out of bigger
+// chunks, and kept on a free list once they are no longer needed,
+// linked through their first word.
+
+#define ExtentPoolChunk	16		// extent blocks to allocate at once
+
+static Extent *freeExtentBlocks = NULL;	// unused in-core extent blocks
+
+//----------------------------------------------------------------------
+// AllocExtentBlock
+// 	Return room for the in-core copy of an extent block, taking it
+//	from the free list, or refilling the list if it is empty.
+//----------------------------------------------------------------------
+
+static Extent *
+AllocExtentBlock()
+{
+    Extent *block;
+
+    if (freeExtentBlocks == NULL) {
+	block = new Extent[ExtentPoolChunk * ExtentsPerBlock];
+	for (int i = 0; i < ExtentPoolChunk; i++) {
+	    *(Extent **) block = freeExtentBlocks;
+	    freeExtentBlocks = block;
+	    block += ExtentsPerBlock;
+	}
+    }
+    block = freeExtentBlocks;
+    freeExtentBlocks = *(Extent **) block;
+    return block;
+}
+
+//----------------------------------------------------------------------
+// FreeExtentBlock
+// 	Put the in-core copy of an extent block back on the free list.
+//----------------------------------------------------------------------
+
+static void
+FreeExtentBlock(Extent *block)
+{
+    *(Extent **) block = freeExtentBlocks;
+    freeExtentBlocks = block;
+}
 
 //----------------------------------------------------------------------
 // MP4 mod tag
@@ -41,30 +95,28 @@ FileHeader::FileHeader()
 {
 	numBytes = -1;
 	numSectors = -1;
-	memset(dataSectors, -1, sizeof(dataSectors));
-
-    for(int i = 0; i < NumIndirect; i ++) {
-        indirectTable[i] = NULL;
-    }
-
-    for(int i = 0; i < NumTripleIndirect; i ++) {
-        tripleIndirectTable[i] = NULL;
-    }
+	numExtents = 0;
+	for (int i = 0; i < NumDirectExtents; i++) {
+	    extents[i].start = -1;
+	    extents[i].length = 0;
+	}
+	for (int i = 0; i < NumExtentBlocks; i++) {
+	    extentBlocks[i] = -1;
+	    extentTable[i] = NULL;
+	    extentDirty[i] = FALSE;
+	}
 }
 
 //----------------------------------------------------------------------
 // MP4 mod tag
 // FileHeader::~FileHeader
-//	Currently, there is not need to do anything in destructor function.
-//	However, if you decide to add some "in-core" data in header
-//	Always remember to deallocate their space or you will leak memory
+//	De-allocate the in-core copies of the extent blocks.
 //----------------------------------------------------------------------
 FileHeader::~FileHeader()
 {
-
-    for(int i = 0; i < NumIndirect; i++) {
-        if(indirectTable[i])
-            delete indirectTable[i];
+    for (int i = 0; i < NumExtentBlocks; i++) {
+        if (extentTable[i] != NULL)
+            FreeExtentBlock(extentTable[i]);
     }
 }
 
@@ -75,138 +127,370 @@ FileHeader::~FileHeader()
 //	Return FALSE if there are not enough free blocks to accomodate
 //	the new file.
 //
+//	A file of up to InlineSize bytes needs no data blocks at all; it
+//	is kept inline, and gets them if it grows (see Extend).
+//
 //	"freeMap" is the bit map of free disk sectors
-//	"fileSize" is the bit map of free disk sectors
+//	"fileSize" is the number of bytes in the file
+//	"goal" is the sector to start looking for free sectors from
+//		(normally the one holding the file header)
 //----------------------------------------------------------------------
 
 bool
-FileHeader::Allocate(PersistentBitmap *freeMap, int fileSize)
+FileHeader::Allocate(PersistentBitmap *freeMap, int fileSize, int goal)
 { 
-    int indirectSize;
-    int offset;     // # of Sector left after allocate to direct index.
-    int indexNeeds; // # of indirect table do we need
-    int sectorNeeds;
-   
-    numBytes = fileSize;
-    numSectors  = divRoundUp(fileSize, SectorSize);
-    
-    
-    if (freeMap->NumClear() < numSectors)
-	return FALSE;		// not enough space
-    
-    sectorNeeds = numSectors <= NumDirect ? numSectors : NumDirect; // Calculate the # of sectors for direct table
-    offset = numSectors - sectorNeeds; // calculate how many sector do wee still need after allocate direct level
-    
-    // allocate direct level datasector
-    for (int i = 0; i < sectorNeeds; i++) {
-	    dataSectors[i] = freeMap->FindAndSet();
-        // since we checked that there was enough free space,
-	    // we expect this to succeed
-	    ASSERT(dataSectors[i] >= 0);
+    numBytes = 0;
+    numSectors = 0;
+    numExtents = 0;
+    return Extend(freeMap, fileSize, goal, 0);
+}
+
+//----------------------------------------------------------------------
+// FileHeader::Extend
+// 	Make the file "newSize" bytes long, allocating data blocks for
+//	any new sectors out of the map of free disk blocks.  The file is
+//	grown in place where the sectors after its last extent are free;
+//	the rest is allocated in as few runs of consecutive sectors as
+//	possible, looking first after the end of the file (or, for an
+//	empty file, after "goal"), so that the file stays close to its
+//	header.  Return FALSE, leaving the file as it was, if there
+//	are not enough free blocks.
+//
+//	The contents of the new part of the file are garbage; it is up
+//	to the caller to write them.  The exception is a gap the caller
+//	is leaving, between the old end of the file and "zeroTo": that
+//	is zeroed here, before the new length is set, so that no other
+//	thread sharing the header can write there until it is done.
+//
+//	An inline file stays inline if it still fits in the header (the
+//	new part is then zeroed), and otherwise is moved out to data
+//	sectors (see Uninline).
+//
+//	"freeMap" is the bit map of free disk sectors
+//	"newSize" is the new length of the file, in bytes
+//	"goal" is the sector to start looking for free sectors from, if
+//		the file has none yet
+//	"zeroTo" is where the caller's write starts; 0 if none
+//----------------------------------------------------------------------
+
+bool
+FileHeader::Extend(PersistentBitmap *freeMap, int newSize, int goal,
+							int zeroTo)
+{
+    int sectorsLeft = divRoundUp(newSize, SectorSize) - numSectors;
+    int oldSectors = numSectors;
+    int start, length;
+    Extent *last;
+
+    if (newSize <= numBytes)
+	return TRUE;
+    if (IsInline()) {
+	if (newSize <= InlineSize) {
+	    bzero(InlineData() + numBytes, newSize - numBytes);
+	    numBytes = newSize;
+	    return TRUE;
+	}
+	if (numBytes > 0)
+	    return Uninline(freeMap, newSize, goal, zeroTo);
     }
+    if (freeMap->NumClear() < sectorsLeft)
+	return FALSE;		// not enough space
 
+    if (sectorsLeft > 0 && numExtents > 0) {
+	last = GetExtent(numExtents - 1);
+	start = last->start + last->length;
+	for (length = 0; length < sectorsLeft && start + length < NumSectors
+			&& !freeMap->Test(start + length); length++)
+	    freeMap->Mark(start + length);
+	last->length += length;
+	ExtentChanged(numExtents - 1);
+	numSectors += length;
+	sectorsLeft -= length;
+	goal = start + length;
+    }
 
-    if(offset > 0) {
-        indexNeeds  = divRoundUp(offset, NumMaxSect);       // calculate how many indirect index do we need
-        indirectSize = indexNeeds <= NumIndirect ? indexNeeds : NumIndirect;
-        sectorNeeds = offset; // calculate how many sector we need to allocate
-        for(int i = 0; i < indirectSize; i ++) {
-            int sectorNum;
-            bool result;
-            dataSectors[NumDirect + i] = freeMap->FindAndSet(); // get sector to store info for indirect table
-	        ASSERT(dataSectors[NumDirect + i] >= 0);
-
-            
-            sectorNum = NumMaxSect > offset ? offset : NumMaxSect;
-            offset -= sectorNum;
-            ASSERT(offset >= 0);
-
-            indirectTable[i] = new FileHeader();
-            result = indirectTable[i]->AllocateIndirect(freeMap, sectorNum);
-            if(!result) return result;
-        }
-    
+    while (sectorsLeft > 0) {
+	start = freeMap->FindAndSetRun(sectorsLeft, &length, goal);
+	if (start == -1)
+	    break;
+	if (!AddExtent(freeMap, start, length)) {
+	    for (int i = 0; i < length; i++)
+		freeMap->Clear(start + i);
+	    break;		// not enough space for the extent blocks
+	}
+	sectorsLeft -= length;
     }
 
+    if (sectorsLeft > 0) {
+	RemoveSectors(freeMap, numSectors - oldSectors);
+	return FALSE;
+    }
+    ZeroFill(numBytes, min(zeroTo, newSize));
+    numBytes = newSize;
     return TRUE;
 }
 
+//----------------------------------------------------------------------
+// FileHeader::Uninline
+// 	Move the data of an inline file out of the header, into the
+//	first of the data sectors allocated to make it "newSize" bytes
+//	long.  Return FALSE, leaving the file inline, if there are not
+//	enough free blocks.
+//
+//	The data sector is written here, before the caller writes back
+//	the header that points to it.
+//
+//	"freeMap" is the bit map of free disk sectors
+//	"newSize" is the new length of the file, in bytes
+//	"goal" is the sector to start looking for free sectors from
+//	"zeroTo" is where the caller's write starts (see Extend)
+//----------------------------------------------------------------------
+
 bool
-FileHeader::AllocateIndirect(PersistentBitmap *freeMap, int sectorNum)
+FileHeader::Uninline(PersistentBitmap *freeMap, int newSize, int goal,
+							int zeroTo)
 {
-    if (freeMap->NumClear() < sectorNum)
-	return FALSE;		// not enough space
-    
-    numBytes = sectorNum * SectorSize;
-    numSectors = sectorNum;
+    char data[SectorSize];
+    int oldBytes = numBytes;
 
-    for(int i = 0; i < sectorNum; i ++) {
-        dataSectors[i] = freeMap->FindAndSet();
+    ASSERT(IsInline() && InlineSize <= SectorSize);
+    bzero(data, SectorSize);
+    bcopy(InlineData(), data, numBytes);
+
+    numBytes = 0;
+    for (int i = 0; i < NumDirectExtents; i++) {
+	extents[i].start = -1;
+	extents[i].length = 0;
+    }
+    for (int i = 0; i < NumExtentBlocks; i++)
+	extentBlocks[i] = -1;
 
-        ASSERT(dataSectors[i] >= 0);
+    if (!Extend(freeMap, newSize, goal, zeroTo)) {
+	bcopy(data, InlineData(), InlineSize);
+	numBytes = oldBytes;
+	return FALSE;
     }
+    kernel->synchDisk->WriteSector(ByteToSector(0), data);
     return TRUE;
 }
 
+//----------------------------------------------------------------------
+// FileHeader::ZeroFill
+// 	Write zeroes over bytes "from" up to "to" of the file, which must
+//	already have sectors allocated for them.  Bytes before "from" in
+//	its sector are kept; the rest of the sector holding the last
+//	byte is zeroed too, since the caller is about to write it.
+//----------------------------------------------------------------------
+
+void
+FileHeader::ZeroFill(int from, int to)
+{
+    char data[SectorSize];
+
+    for (int i = divRoundDown(from, SectorSize);
+			i <= divRoundDown(to - 1, SectorSize) && from < to; i++) {
+	if (i * SectorSize < from) {
+	    kernel->synchDisk->ReadSector(ByteToSector(from), data);
+	    bzero(&data[from % SectorSize], SectorSize - from % SectorSize);
+	} else
+	    bzero(data, SectorSize);
+	kernel->synchDisk->WriteSector(ByteToSector(i * SectorSize), data);
+    }
+}
 
 //----------------------------------------------------------------------
-// FileHeader::Deallocate
-// 	De-allocate all the space allocated for data blocks for this file.
+// FileHeader::AddExtent
+// 	Append a run of sectors, already marked in use in the free map,
+//	to the end of the file.  If the run follows on from the last
+//	extent, that extent is just made longer; otherwise a new extent
+//	is used, allocating a new extent block if need be.
+//	Return FALSE if the file has no room for another extent.
 //
 //	"freeMap" is the bit map of free disk sectors
+//	"start" is the first sector of the run
+//	"length" is the number of sectors in the run
 //----------------------------------------------------------------------
 
-void 
-FileHeader::Deallocate(PersistentBitmap *freeMap)
+bool
+FileHeader::AddExtent(PersistentBitmap *freeMap, int start, int length)
 {
-    for (int i = 0; i < NumMaxSect; i++) {
-        if(dataSectors[i] != -1) {
-            ASSERT(freeMap->Test((int) dataSectors[i]));  // ought to be marked!
-	        freeMap->Clear((int) dataSectors[i]);
-        }
+    Extent *extent;
+    int block;
+
+    if (numExtents > 0) {
+	extent = GetExtent(numExtents - 1);
+	if (extent->start + extent->length == start) {
+	    extent->length += length;
+	    ExtentChanged(numExtents - 1);
+	    numSectors += length;
+	    return TRUE;
+	}
     }
-    
-    
-    for(int i = 0; i < NumIndirect; i++) {
-        if(indirectTable[i]) {
-            for(int j = 0; j < indirectTable[i]->numSectors; j++) {
-                ASSERT(freeMap->Test((int) indirectTable[i]->dataSectors[j]));
-                freeMap->Clear((int) indirectTable[i]->dataSectors[j]);
-            }
-        }
+
+    if (numExtents == MaxExtents)
+	return FALSE;		// file is too fragmented
+    if (numExtents >= NumDirectExtents
+	    && (numExtents - NumDirectExtents) % ExtentsPerBlock == 0) {
+	block = (numExtents - NumDirectExtents) / ExtentsPerBlock;
+	extentBlocks[block] = freeMap->FindAndSet(start);
+	if (extentBlocks[block] == -1)
+	    return FALSE;
+	extentTable[block] = AllocExtentBlock();
+	for (int i = 0; i < ExtentsPerBlock; i++) {
+	    extentTable[block][i].start = -1;
+	    extentTable[block][i].length = 0;
+	}
     }
 
+    extent = GetExtent(numExtents);
+    extent->start = start;
+    extent->length = length;
+    ExtentChanged(numExtents++);
+    numSectors += length;
+    return TRUE;
 }
 
 //----------------------------------------------------------------------
-// FileHeader::FetchFrom
-// 	Fetch contents of file header from disk. 
+// FileHeader::RemoveSectors
+// 	Take the last "count" data sectors off the end of the file,
+//	returning them, and any extent blocks no longer needed, to the
+//	map of free disk blocks.  Used to undo a partly done Extend.
 //
-//	"sector" is the disk sector containing the file header
+//	"freeMap" is the bit map of free disk sectors
+//	"count" is the number of sectors to remove
 //----------------------------------------------------------------------
 
 void
-FileHeader::FetchFrom(int sector)
+FileHeader::RemoveSectors(PersistentBitmap *freeMap, int count)
 {
-    kernel->synchDisk->ReadSector(sector, (char *)this);
-    
-    for(int i = 0; i < NumIndirect; i++) {
-        if(dataSectors[NumDirect + i] == -1) break;
-        
-        indirectTable[i] = new FileHeader();
-        indirectTable[i]->FetchFromIndirect(dataSectors[NumDirect + i]);
+    Extent *extent;
+    int block;
+
+    ASSERT(count <= numSectors);
+    while (count > 0) {
+	extent = GetExtent(numExtents - 1);
+	while (count > 0 && extent->length > 0) {
+	    extent->length--;
+	    numSectors--;
+	    count--;
+	    freeMap->Clear(extent->start + extent->length);
+	}
+	ExtentChanged(numExtents - 1);
+	if (extent->length > 0)
+	    break;
+
+	extent->start = -1;
+	numExtents--;
+	if (numExtents >= NumDirectExtents
+		&& (numExtents - NumDirectExtents) % ExtentsPerBlock == 0) {
+	    block = (numExtents - NumDirectExtents) / ExtentsPerBlock;
+	    freeMap->Clear(extentBlocks[block]);
+	    extentBlocks[block] = -1;
+	    FreeExtentBlock(extentTable[block]);
+	    extentTable[block] = NULL;
+	    extentDirty[block] = FALSE;
+	}
+    }
+}
+
+//----------------------------------------------------------------------
+// FileHeader::GetExtent
+// 	Return the "i"th extent of the file, either from the header
+//	itself or from one of the extent blocks.  The first time an
+//	extent block is needed, read it in.
+//
+//	Reading may block; since the header may be shared by several
+//	OpenFiles, another thread may read in the same block meanwhile,
+//	in which case the copy we read is thrown away.
+//----------------------------------------------------------------------
+
+Extent *
+FileHeader::GetExtent(int i)
+{
+    int block;
+    Extent *table;
+
+    ASSERT(i >= 0 && i < MaxExtents);
+    if (i < NumDirectExtents)
+	return &extents[i];
+    i -= NumDirectExtents;
+    block = i / ExtentsPerBlock;
+    if (extentTable[block] == NULL) {
+	ASSERT(extentBlocks[block] != -1);
+	table = AllocExtentBlock();
+	kernel->synchDisk->ReadSector(extentBlocks[block], (char *) table);
+	if (extentTable[block] == NULL)
+	    extentTable[block] = table;
+	else
+	    FreeExtentBlock(table);	// someone beat us to it
+    }
+    return &extentTable[block][i % ExtentsPerBlock];
+}
+
+//----------------------------------------------------------------------
+// FileHeader::ExtentChanged
+// 	Note that the "i"th extent has been changed, so that WriteBack
+//	writes its extent block.  The extents in the header itself are
+//	always written.
+//----------------------------------------------------------------------
+
+void
+FileHeader::ExtentChanged(int i)
+{
+    if (i >= NumDirectExtents)
+	extentDirty[(i - NumDirectExtents) / ExtentsPerBlock] = TRUE;
+}
+
+//----------------------------------------------------------------------
+// FileHeader::Deallocate
+// 	De-allocate all the space allocated for data blocks for this file,
+//	along with its extent blocks.
+//
+//	"freeMap" is the bit map of free disk sectors
+//----------------------------------------------------------------------
+
+void 
+FileHeader::Deallocate(PersistentBitmap *freeMap)
+{
+    Extent *extent;
+
+    if (IsInline())
+	return;			// no data blocks, nor extent blocks
+    for (int i = 0; i < numExtents; i++) {
+	extent = GetExtent(i);
+	for (int j = 0; j < extent->length; j++) {
+	    ASSERT(freeMap->Test(extent->start + j));  // ought to be marked!
+	    freeMap->Clear(extent->start + j);
+	}
+    }
+    for (int i = 0; i < NumExtentBlocks; i++) {
+	if (extentBlocks[i] != -1) {
+	    ASSERT(freeMap->Test(extentBlocks[i]));
+	    freeMap->Clear(extentBlocks[i]);
+	}
     }
 }
 
+//----------------------------------------------------------------------
+// FileHeader::FetchFrom
+// 	Fetch contents of file header from disk.  Its extent blocks are
+//	left on disk until they are needed (see GetExtent).
+//
+//	"sector" is the disk sector containing the file header
+//----------------------------------------------------------------------
+
 void
-FileHeader::FetchFromIndirect(int sector)
+FileHeader::FetchFrom(int sector)
 {
     kernel->synchDisk->ReadSector(sector, (char *)this);
 }
 
 //----------------------------------------------------------------------
 // FileHeader::WriteBack
-// 	Write the modified contents of the file header back to disk. 
+// 	Write the modified contents of the file header back to disk,
+//	along with those of its extent blocks that have changed since
+//	they were last written.  Growing a big file usually changes
+//	only its last extent block, if any.
 //
 //	"sector" is the disk sector to contain the file header
 //----------------------------------------------------------------------
@@ -217,21 +501,15 @@ FileHeader::WriteBack(int sector)
     char buf[SectorSize];
     memcpy(&buf, (char *)this, sizeof(buf));
     kernel->synchDisk->WriteSector(sector, buf); 
-    for(int i = 0; i < NumIndirect; i ++) {
-        if(indirectTable[i]) {
-            indirectTable[i]->WriteBackIndirect(dataSectors[i + NumDirect]); 
+    for (int i = 0; i < NumExtentBlocks; i++) {
+        if (extentTable[i] && extentDirty[i]) {
+            kernel->synchDisk->WriteSector(extentBlocks[i],
+					(char *)extentTable[i]);
+            extentDirty[i] = FALSE;
         }
     }
 }
 
-void
-FileHeader::WriteBackIndirect(int sector)
-{
-    char buf[SectorSize];
-    memcpy(&buf, (char *)this, sizeof(buf));
-    kernel->synchDisk->WriteSector(sector, buf); 
-}
-
 //----------------------------------------------------------------------
 // FileHeader::ByteToSector
 // 	Return which disk sector is storing a particular byte within the file.
@@ -246,16 +524,46 @@ int
 FileHeader::ByteToSector(int offset)
 {
     int position = offset / SectorSize;
-    if(position < NumDirect)
-        return(dataSectors[position]);
-    
-    position -= NumDirect;
+    Extent *extent;
     
-    if(position >= 0) {
-        int index = position / NumMaxSect;
-        int p = position % NumMaxSect;
-        return(indirectTable[index]->dataSectors[p]);
+    for (int i = 0; i < numExtents; i++) {
+	extent = GetExtent(i);
+	if (position < extent->length)
+	    return extent->start + position;
+	position -= extent->length;
     }
+    ASSERT(FALSE);		// offset is past the end of the file
+    return -1;
+}
+
+//----------------------------------------------------------------------
+// FileHeader::ReadInline/WriteInline
+// 	Read/write part of the data of an inline file, "count" bytes
+//	starting at "position".  A write may grow the file, up to
+//	InlineSize bytes; any gap between the old end of the file and
+//	"position" is filled with zeroes.  It is up to the caller to
+//	write the header back to disk.
+//
+//	"into" -- the buffer to contain the data read
+//	"from" -- the buffer containing the data to be written
+//----------------------------------------------------------------------
+
+void
+FileHeader::ReadInline(char *into, int count, int position)
+{
+    ASSERT(IsInline() && position >= 0 && position + count <= numBytes);
+    bcopy(InlineData() + position, into, count);
+}
+
+void
+FileHeader::WriteInline(char *from, int count, int position)
+{
+    ASSERT(IsInline() && position >= 0 && position + count <= InlineSize);
+    if (position > numBytes)
+	bzero(InlineData() + numBytes, position - numBytes);
+    bcopy(from, InlineData() + position, count);
+    if (position + count > numBytes)
+	numBytes = position + count;
 }
 
 //----------------------------------------------------------------------
@@ -280,15 +588,19 @@ FileHeader::Print()
 {
     int i, j, k;
     char *data = new char[SectorSize];
+    Extent *extent;
 
-    printf("FileHeader contents.  File size: %d.  File blocks:\n", numBytes);
-    //for (i = 0; i < numSectors; i++)
-    for (i = 0; i < 16; i++)
-	printf("%d ", dataSectors[i]);
+    printf("FileHeader contents.  File size: %d.  File extents:\n", numBytes);
+    for (i = 0; i < numExtents; i++) {
+	extent = GetExtent(i);
+	printf("%d+%d ", extent->start, extent->length);
+    }
     printf("\nFile contents:\n");
-    //for (i = k = 0; i < numSectors; i++) {
-    for (i = k = 0; i < 16; i++) {
-	kernel->synchDisk->ReadSector(dataSectors[i], data);
+    for (i = k = 0; k < numBytes; i++) {
+	if (IsInline())
+	    bcopy(InlineData(), data, numBytes);
+	else
+	    kernel->synchDisk->ReadSector(ByteToSector(i * SectorSize), data);
         for (j = 0; (j < SectorSize) && (k < numBytes); j++, k++) {
 	    if ('\040' <= data[j] && data[j] <= '\176')   // isprint(data[j])
 		printf("%c", data[j]);
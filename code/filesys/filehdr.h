@@ -17,50 +17,76 @@
 #include "disk.h"
 #include "pbitmap.h"
 
-//#define NumDirect 	((SectorSize - 2 * sizeof(int)) / sizeof(int))
-#define MaxFileSize 	(NumDirect * SectorSize)
-#define NumIndex    ((SectorSize - 1 * sizeof(int)) / sizeof(int))
-#define NumDirect 16
-#define NumIndirect 14
-#define NumMaxSect 30
-#define NumTripleIndirect 6
+// A file's data is described by a list of extents -- runs of
+// consecutive disk sectors.  The first NumDirectExtents extents are
+// kept in the header itself; the rest are kept in up to NumExtentBlocks
+// extent blocks, each a sector full of extents.
 
+#define NumDirectExtents	11
+#define NumExtentBlocks		7
+#define ExtentsPerBlock		((int) (SectorSize / sizeof(Extent)))
+#define MaxExtents		(NumDirectExtents + \
+				    NumExtentBlocks * ExtentsPerBlock)
+
+// A file with no data sectors keeps its data in the header itself,
+// in the space the extents and extent block numbers would take up.
+
+#define InlineSize		((int) (NumDirectExtents * sizeof(Extent) + \
+				    NumExtentBlocks * sizeof(int)))
+
+// The following class defines one extent: "length" sectors, starting
+// at sector "start".
+
+class Extent {
+  public:
+    int start;				// First sector of the run
+    int length;				// Number of sectors in the run
+};
 
 // The following class defines the Nachos "file header" (in UNIX terms,  
 // the "i-node"), describing where on disk to find all of the data in the file.
-// The file header is organized as a simple table of pointers to
-// data blocks. 
+// The file header is organized as a table of extents, each pointing to
+// a run of consecutive data blocks.  Since the allocator hands out
+// the longest runs it can, a file usually needs only a few extents,
+// and reading it sequentially moves the disk head from one track to
+// the next, rather than back and forth.
+//
+// A small file (up to InlineSize bytes) has no data sectors at all:
+// its data is kept in the header sector, in place of the extents, so
+// that reading it takes one disk read instead of two.  When it grows
+// past InlineSize, its data is moved out to a data sector.
 //
 // The file header data structure can be stored in memory or on disk.
-// When it is on disk, it is stored in a single sector -- this means
-// that we assume the size of this data structure to be the same
-// as one disk sector.  Without indirect addressing, this
-// limits the maximum file length to just under 4K bytes.
+// When it is on disk, it is stored in a single sector (plus its extent
+// blocks, if any) -- this means that we assume the size of the disk
+// part of this data structure to be the same as one disk sector.
 //
 // There is no constructor; rather the file header can be initialized
 // by allocating blocks for the file (if it is a new file), or by
 // reading it from disk.
 
-enum HeaderType {file_type, indirect_type};
-
 class FileHeader {
   public:
 	// MP4 mod tag
 	FileHeader(); // dummy constructor to keep valgrind happy
-	FileHeader(HeaderType type); // dummy constructor to keep valgrind happy
 	~FileHeader();
 	
-    bool Allocate(PersistentBitmap *bitMap, int fileSize);// Initialize a file header, 
+    bool Allocate(PersistentBitmap *bitMap, int fileSize, int goal);
+						// Initialize a file header, 
 						//  including allocating space 
 						//  on disk for the file data
-    bool AllocateIndirect(PersistentBitmap *bitMap, int sectorNum);// Initialize a file header, 
+    bool Extend(PersistentBitmap *bitMap, int newSize, int goal,
+							int zeroTo);
+					// Make the file "newSize" bytes long,
+					//  allocating more data blocks if
+					//  need be, as near "goal" as we can,
+					//  and zeroing the new bytes before
+					//  "zeroTo"
     void Deallocate(PersistentBitmap *bitMap);  // De-allocate this file's 
 						//  data blocks
 
     void FetchFrom(int sectorNumber); 	// Initialize file header from disk
-    void FetchFromIndirect(int sector);
     void WriteBack(int sectorNumber); 	// Write modifications to file header
-    void WriteBackIndirect(int sectorNumber); 	// Write modifications to file header
 					//  back to disk
 
     int ByteToSector(int offset);	// Convert a byte offset into the file
@@ -70,31 +96,58 @@ class FileHeader {
     int FileLength();			// Return the length of the file 
 					// in bytes
 
+    bool IsInline() { return numSectors == 0; }
+					// Is the file's data kept in the
+					// header?
+    void ReadInline(char *into, int numBytes, int position);
+    void WriteInline(char *from, int numBytes, int position);
+					// Read/write the data of an inline
+					// file, growing it if need be
+
     void Print();			// Print the contents of the file.
 
   private:
 	
 	/*
-		MP4 hint:
-		You will need a data structure to store more information in a header.
-		Fields in a class can be separated into disk part and in-core part.
-		Disk part are data that will be written into disk.
-		In-core part are data only lies in memory, and are used to maintain the data structure of this class.
-		In order to implement a data structure, you will need to add some "in-core" data
-		to maintain data structure.
-		
-		Disk Part - numBytes, numSectors, dataSectors occupy exactly 128 bytes and will be
-		written to a sector on disk.
-		In-core part - none
+		Disk Part - numBytes, numSectors, numExtents, extents and
+		extentBlocks occupy exactly 128 bytes and will be
+		written to a sector on disk.  For an inline file,
+		extents and extentBlocks (which are next to each
+		other, with no padding) hold the file's data instead.
+		In-core part - extentTable, the contents of the extent
+		blocks, each written to its own sector.  A block is
+		only read in when one of its extents is needed, and
+		its entry is NULL until then.  extentDirty says which
+		of them need writing back.
 		
 	*/
     int numBytes;			// Number of bytes in the file
     int numSectors;			// Number of data sectors in the file
-    int dataSectors[NumMaxSect];		// Disk sector numbers for each data 
-					// block in the file
+    int numExtents;			// Number of extents in use
+    Extent extents[NumDirectExtents];	// The first few runs of data
+					// sectors in the file
+    int extentBlocks[NumExtentBlocks];	// Disk sectors holding the rest
+					// of the extents, -1 if unused
+
+    Extent *extentTable[NumExtentBlocks];	// Contents of the extent blocks,
+					// NULL if not read in yet
+    bool extentDirty[NumExtentBlocks];	// Has the extent block changed
+					// since it was last written?
 
-    FileHeader *indirectTable[NumIndirect];
-    FileHeader *tripleIndirectTable[NumTripleIndirect];
+    char *InlineData() { return (char *) extents; }
+					// Where an inline file's data is
+    Extent *GetExtent(int i);		// Return the "i"th extent, reading
+					// in its extent block if need be
+    void ExtentChanged(int i);		// Note that the "i"th extent has
+					// been changed
+    bool Uninline(PersistentBitmap *freeMap, int newSize, int goal,
+							int zeroTo);
+					// Move inline data out to a sector
+    void ZeroFill(int from, int to);	// Zero bytes "from" up to "to"
+    bool AddExtent(PersistentBitmap *freeMap, int start, int length);
+					// Append a run of sectors to the file
+    void RemoveSectors(PersistentBitmap *freeMap, int count);
+					// Free the last "count" sectors
 };
 
 #endif // FILEHDR_H
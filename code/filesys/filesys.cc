@@ -28,16 +28,25 @@
 //	modified part of the directory and/or bitmap, we simply discard
 //	the changed version, without writing it back to disk.
 //
+//	The writes made by each such operation form one transaction in
+//	the metadata journal (see journal.h), so that after a crash,
+//	either all of them or none of them take effect.
+//
+//	The bitmap is read into memory once, when Nachos starts, and
+//	kept there; only the parts of it that an operation changes are
+//	written back.
+//
 // 	Our implementation at this point has the following restrictions:
 //
-//	   there is no synchronization for concurrent accesses
-//	   files have a fixed size, set when the file is created
-//	   files cannot be bigger than about 3KB in size
-//	   there is no hierarchical directory structure, and only a limited
-//	     number of files can be added to the system
-//	   there is no attempt to make the system robust to failures
-//	    (if Nachos exits in the middle of an operation that modifies
-//	    the file system, it may corrupt the disk)
+//	   metadata operations are serialized by a single lock, so
+//	    they don't overlap even when they wait for the disk
+//	   a file can have at most MaxExtents runs of sectors (see
+//	    filehdr.h), so on a badly fragmented disk it may stop
+//	    growing before the disk is full
+//	   path names are at most MAX_PATH_LEN characters long, and
+//	    each name in a path at most FileNameMaxLen
+//	   only metadata is journaled; if Nachos exits in the middle of
+//	    writing a file, some of the data written may be lost
 //
 // Copyright (c) 1992-1993 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation 
@@ -51,6 +60,11 @@
 #include "directory.h"
 #include "filehdr.h"
 #include "filesys.h"
+#include "dcache.h"
+#include "hdrtable.h"
+#include "journal.h"
+#include "synchdisk.h"
+#include "synch.h"
 
 // Sectors containing the file headers for the bitmap of free sectors,
 // and the directory of files.  These file headers are placed in well-known 
@@ -70,9 +84,18 @@
 FileSystem::FileSystem(bool format)
 { 
     DEBUG(dbgFile, "Initializing the file system.");
+    lock = new Lock("file system lock");
+    dentryCache = new DentryCache(DentryCacheSize);
+    journal = new Journal(JournalSector);
+    for (int i = 0; i < MAX_SYS_OPENF; i++) {
+	SysWideOpenFileTable[i] = NULL;
+	nextFreeId[i] = i + 1;
+    }
+    nextFreeId[MAX_SYS_OPENF - 1] = -1;
+    freeIds = 0;
     if (format) {
-        PersistentBitmap *freeMap = new PersistentBitmap(NumSectors);
-        Directory *directory = new Directory(NumDirEntries);
+        freeMap = new PersistentBitmap(NumSectors);
+        Directory *directory = new Directory(NumDirBlocks);
 		FileHeader *mapHdr = new FileHeader;
 		FileHeader *dirHdr = new FileHeader;
 
@@ -82,11 +105,21 @@ FileSystem::FileSystem(bool format)
 		// (make sure no one else grabs these!)
 		freeMap->Mark(FreeMapSector);	    
 		freeMap->Mark(DirectorySector);
+		freeMap->Mark(JournalSector);
 
 		// Second, allocate space for the data blocks containing the contents
 		// of the directory and bitmap files.  There better be enough space!
-		ASSERT(mapHdr->Allocate(freeMap, FreeMapFileSize));
-        ASSERT(dirHdr->Allocate(freeMap, DirectoryFileSize));
+		ASSERT(mapHdr->Allocate(freeMap, FreeMapFileSize, FreeMapSector));
+        ASSERT(dirHdr->Allocate(freeMap, DirectoryFileSize, DirectorySector));
+
+		// The log goes right after them, in one piece
+		int logStart, logLength;
+		logStart = freeMap->FindAndSetRun(JournalSize, &logLength);
+		if (logLength != JournalSize) {
+		    cerr << "Disk too small for a journal of " << JournalSize
+						<< " sectors\n";
+		    Exit(1);
+		}
 
 		// Flush the bitmap and directory FileHeaders back to disk
 		// We need to do this before we can "Open" the file, since open
@@ -113,21 +146,32 @@ FileSystem::FileSystem(bool format)
         DEBUG(dbgFile, "Writing bitmap and directory back to disk.");
 		freeMap->WriteBack(freeMapFile);	 // flush changes to disk
 		directory->WriteBack(directoryFile);
+		journal->Format(logStart, logLength);
 
 		if (debug->IsEnabled('f')) {
 			freeMap->Print();
 			directory->Print();
         }
-        delete freeMap; 
 		delete directory; 
 		delete mapHdr; 
 		delete dirHdr;
     } else {
-		// if we are not formatting the disk, just open the files representing
-		// the bitmap and directory; these are left open while Nachos is running
+		// if we are not formatting the disk, first finish off whatever
+		// operations were committed to the journal, in case Nachos
+		// crashed before they reached the disk
+        if (!journal->Recover()) {
+	    cerr << "No journal on the disk; reformat it with -f\n";
+	    Exit(1);
+	}
+
+		// then just open the files representing the bitmap and
+		// directory; these are left open while Nachos is running
         freeMapFile = new OpenFile(FreeMapSector);
         directoryFile = new OpenFile(DirectorySector);
+        freeMap = new PersistentBitmap(freeMapFile, NumSectors);
     }
+    kernel->synchDisk->SetJournal(journal);
+    freeMap->SetJournal(journal);
 }
 
 //----------------------------------------------------------------------
@@ -136,19 +180,25 @@ FileSystem::FileSystem(bool format)
 //----------------------------------------------------------------------
 FileSystem::~FileSystem()
 {
+	for (int i = 0; i < MAX_SYS_OPENF; i++)
+	    delete SysWideOpenFileTable[i];
+	delete freeMap;
 	delete freeMapFile;
 	delete directoryFile;
+	delete dentryCache;
+	delete journal;
+	delete lock;
 }
 
 //----------------------------------------------------------------------
 // FileSystem::Create
 // 	Create a file in the Nachos file system (similar to UNIX create).
-//	Since we can't increase the size of files dynamically, we have
-//	to give Create the initial size of the file.
+//	Files grow as they are written, but Create can be given an
+//	initial size to allocate space for up front.
 //
 //	The steps to create a file are:
 //	  Make sure the file doesn't already exist
-//        Allocate a sector for the file header
+//        Allocate a sector for the file header (see PlaceHeader)
 // 	  Allocate space on disk for the data blocks for the file
 //	  Add the name to the directory
 //	  Store the new file header on disk 
@@ -159,11 +209,20 @@ FileSystem::~FileSystem()
 // 	Create fails if:
 //   		file is already in directory
 //	 	no free space for file header
-//	 	no free entry for file in directory
 //	 	no free space for data blocks for the file 
+//	 	no free space for the directory to grow
+//
+//	All of it is one journal transaction, begun before any sector
+//	is allocated: adding the name may grow the directory, and the
+//	ExtendFile that does so (see Directory::Grow) then writes the
+//	bitmap, with the new file's sectors in it, as part of this
+//	transaction rather than one of its own.  Add only grows the
+//	directory once it is sure to succeed, so if Create fails,
+//	nothing has been written, and Revert gives back exactly the
+//	sectors taken here.
 //
-// 	Note that this implementation assumes there is no concurrent access
-//	to the file system!
+//	The file system's lock is held throughout, so that no other
+//	thread adds the same name, or takes the sectors we found free.
 //
 //	"name" -- name of file to be created
 //	"initialSize" -- size of file to be created
@@ -172,13 +231,11 @@ FileSystem::~FileSystem()
 int
 FileSystem::Create(char *name, int initialSize, bool isDir)
 {
-    Directory *rootDirectory = new Directory(NumDirEntries);
     Directory *targetDirectory;
     OpenFile *targetFile;
-    PersistentBitmap *freeMap;
     FileHeader *hdr;
     char BasedPath[MAX_PATH_LEN + 1];
-    char act_name[10];
+    char act_name[FileNameMaxLen + 1];
     int success, sector;
     int size = initialSize;
     DEBUG(dbgFile, "Creating file " << name << " size " << initialSize);
@@ -186,35 +243,38 @@ FileSystem::Create(char *name, int initialSize, bool isDir)
 
     if(isDir) size = DirectoryFileSize;
 
-    rootDirectory->FetchFrom(directoryFile);
-    
+    lock->Acquire();
     ExtractBasePath(BasedPath, act_name, name);
-    sector = rootDirectory->SearchPath(BasedPath, 0); // find the sector number of directory.
+    sector = LookupPath(BasedPath); // find the sector number of directory.
 
     if(sector == -1) {
+        lock->Release();
         return 0;
     }
     
     // open and fetch target dir from disk
     targetFile = new OpenFile(sector);
-    targetDirectory = new Directory(NumDirEntries);
+    targetDirectory = new Directory(NumDirBlocks);
     targetDirectory->FetchFrom(targetFile);
     
     
     if (targetDirectory->Find(act_name) != -1) {
       success = 0;			// file is already in directory
-    }else {	
+    } else if (!MakeRoom(targetDirectory, targetFile, act_name)) {
+      success = 0;			// the directory cannot grow enough
+    } else {	
 
-        freeMap = new PersistentBitmap(freeMapFile,NumSectors);
-        sector = freeMap->FindAndSet();	// find a sector to hold the file header
+        journal->Begin();
+        sector = freeMap->FindAndSet(PlaceHeader(sector, isDir));
+					// find a sector to hold the file header
     	if (sector == -1) 		
             success = 0;		// no free block for file header 
-        else if (!targetDirectory->Add(act_name, sector, isDir))
-            success = 0;	// no space in directory
 	    else {
     	    hdr = new FileHeader;
-	        if (!hdr->Allocate(freeMap, size))
+	        if (!hdr->Allocate(freeMap, size, sector))
             	success = FALSE;	// no space on disk for data
+            else if (!targetDirectory->Add(act_name, sector, isDir))
+                success = 0;	// no space for the directory to grow
 	        else {	
 	    	    success = 1;
 		        // everthing worked, flush all changes back to disk
@@ -228,21 +288,176 @@ FileSystem::Create(char *name, int initialSize, bool isDir)
                     delete targetFile;
                     delete targetDirectory;
                     targetFile = new OpenFile(sector);
-                    targetDirectory = new Directory(NumDirEntries);
+                    targetDirectory = new Directory(NumDirBlocks);
                     targetDirectory->WriteBack(targetFile);
                 }
 	        }
             delete hdr;
 	    }
-        delete freeMap;
+        if (!success)
+            freeMap->Revert();		// give back the sectors we took
+        journal->End();
     }
 
-    delete rootDirectory;
     delete targetFile;
     delete targetDirectory;
+    lock->Release();
+    return success;
+}
+
+//----------------------------------------------------------------------
+// FileSystem::MakeRoom
+// 	Make sure that adding "name" to a directory splits at most
+//	MaxSplits of its blocks, so that the Create fits in the log (see
+//	MaxTransactionSectors).  A name can need many more splits, so
+//	they are counted first, on the directory in memory, and all but
+//	the last MaxSplits are then done here, MaxSplits at a time, each
+//	batch a transaction of its own.  The directory is sound after
+//	each batch, with every name in it, so if the Create then fails,
+//	the batches already done can stay.
+//
+//	Return FALSE, with nothing on disk changed, if the name will
+//	not fit however the directory grows; or FALSE if the disk fills
+//	up part way.  Either way "directory" is read back in from disk.
+//
+//	"directory" -- the directory, as read from "dirFile"
+//	"dirFile" -- the directory's file
+//	"name" -- the name to make room for
+//----------------------------------------------------------------------
+
+bool
+FileSystem::MakeRoom(Directory *directory, OpenFile *dirFile, char *name)
+{
+    int splits = directory->SplitsFor(name);
+    bool grown = TRUE;
+
+    while (grown && splits > MaxSplits) {
+	directory->FetchFrom(dirFile);
+	journal->Begin();
+	grown = directory->Expand(MaxSplits);
+	if (grown) {
+	    directory->WriteBack(dirFile);
+	    freeMap->WriteBack(freeMapFile);
+	} else
+	    freeMap->Revert();		// no room on disk
+	journal->End();
+	splits -= MaxSplits;
+    }
+    directory->FetchFrom(dirFile);
+    return (splits >= 0 && grown);
+}
+
+//----------------------------------------------------------------------
+// FileSystem::PlaceHeader
+// 	Decide where to look for a free sector for the header of a new
+//	file, and return the first sector of that track group.  (The
+//	file's data then goes after its header; see FileHeader::Extend.)
+//
+//	A file goes in the same group as its directory, so that looking
+//	it up and reading it need not move the disk head far.  A new
+//	directory goes in the group with the most free sectors, so that
+//	directories, and the files in them, are spread across the disk
+//	and each has room to grow near it; ties go to the first such
+//	group after the parent's.
+//
+//	"dirSector" -- the header sector of the directory the new file
+//		is in
+//	"isDir" -- is the new file a directory?
+//----------------------------------------------------------------------
+
+int
+FileSystem::PlaceHeader(int dirSector, bool isDir)
+{
+    int group = dirSector / SectorsPerGroup;
+
+    if (isDir) {
+	int parent = group, mostFree = -1;
+
+	for (int i = 1; i <= NumGroups; i++) {
+	    int g = (parent + i) % NumGroups;
+	    int numFree = freeMap->NumClear(g * SectorsPerGroup,
+							SectorsPerGroup);
+
+	    if (numFree > mostFree) {
+		group = g;
+		mostFree = numFree;
+	    }
+	}
+    }
+    DEBUG(dbgFile, "Placing new file header in group " << group);
+    return group * SectorsPerGroup;
+}
+
+//----------------------------------------------------------------------
+// FileSystem::ExtendFile
+// 	Grow an open file to "newSize" bytes, allocating data blocks for
+//	it out of the bitmap of free sectors, for a write at "position";
+//	any gap between the old end of the file and "position" is zeroed.
+//	As with Create, if the operation succeeds, the changed file
+//	header and bitmap are written back to disk; if not, they are left
+//	as they were.  Return TRUE if the file could be grown.
+//
+//	The header may be shared with other OpenFiles, and Extend may
+//	wait for the disk part way through changing it, so the file
+//	system's lock is held throughout.  Create already holds it when
+//	it grows a directory.
+//
+//	"hdr" -- the in-memory header of the open file
+//	"hdrSector" -- the disk sector holding "hdr"
+//	"position" -- where the write that needs the space starts
+//	"newSize" -- the number of bytes the file should now hold
+//----------------------------------------------------------------------
+
+bool
+FileSystem::ExtendFile(FileHeader *hdr, int hdrSector, int position,
+								int newSize)
+{
+    bool held = lock->IsHeldByCurrentThread();
+    bool success = TRUE;
+
+    if (!held)
+	lock->Acquire();
+    if (newSize > hdr->FileLength()) {	// else another thread grew it
+	DEBUG(dbgFile, "Extending file at sector " << hdrSector << " to size " << newSize);
+	success = hdr->Extend(freeMap, newSize, hdrSector, position);
+	if (success) {
+	    journal->Begin();
+	    hdr->WriteBack(hdrSector);
+	    freeMap->WriteBack(freeMapFile);
+	    journal->End();
+	}
+    }
+    if (!held)
+	lock->Release();
     return success;
 }
 
+//----------------------------------------------------------------------
+// FileSystem::WriteHeader
+// 	Write the header of an open file back to disk, in a transaction
+//	of its own.  Used when a small file's data, kept inline in its
+//	header sector, is written.  The header sector is metadata, so the
+//	log may hold older images of it; if it were written home directly,
+//	replaying the log after a crash would put the old data back.
+//
+//	"hdr" -- the in-memory header of the open file
+//	"hdrSector" -- the disk sector holding "hdr"
+//----------------------------------------------------------------------
+
+void
+FileSystem::WriteHeader(FileHeader *hdr, int hdrSector)
+{
+    bool held = lock->IsHeldByCurrentThread();
+
+    if (!held)
+	lock->Acquire();
+    journal->Begin();
+    hdr->WriteBack(hdrSector);
+    journal->End();
+    if (!held)
+	lock->Release();
+}
+
 //----------------------------------------------------------------------
 // FileSystem::Open
 // 	Open a file for reading and writing.  
@@ -256,18 +471,16 @@ FileSystem::Create(char *name, int initialSize, bool isDir)
 OpenFile *
 FileSystem::Open(char *name)
 { 
-    Directory *directory = new Directory(NumDirEntries);
     OpenFile *openFile = NULL;
     int sector;
     
     DEBUG(dbgFile, "Opening file" << name);
-    directory->FetchFrom(directoryFile);
-    //sector = directory->Find(name); 
-    sector = directory->SearchPath(name, 0);
+    lock->Acquire();
+    sector = LookupPath(name);
     
     if (sector >= 0) 		
 	openFile = new OpenFile(sector);	// name was found in directory 
-    delete directory;
+    lock->Release();
     return openFile;				// return NULL if not found
 }
 
@@ -280,7 +493,9 @@ FileSystem::Open(char *name)
 //	    Write changes to directory, bitmap back to disk
 //
 //	Return TRUE if the file was deleted, FALSE if the file wasn't
-//	in the file system.
+//	in the file system, or if it (or, for a recursive remove, anything
+//	below it) is still open.  An open file's header is shared by its
+//	OpenFiles, and must not be freed and reused under them.
 //
 //	"name" -- the text name of the file to be removed
 //----------------------------------------------------------------------
@@ -294,17 +509,16 @@ FileSystem::Remove(char *name, bool recur)
     OpenFile  * tarDir;
     char BasePath[MAX_PATH_LEN + 1];
     char filename[FileNameMaxLen + 1];
-    PersistentBitmap *freeMap;
     FileHeader *fileHdr;
     int sector;
+    bool destroyed;
    
-    OPENDIR(baseDirectory, directoryFile);
+    lock->Acquire();
     ExtractBasePath(BasePath, filename, name);
-    sector = baseDirectory->SearchPath(BasePath, 0);
-
-    delete baseDirectory;
+    sector = LookupPath(BasePath);
 
     if (sector == -1) {
+       lock->Release();
        return FALSE;			 // file directory not found 
     }
     
@@ -312,20 +526,30 @@ FileSystem::Remove(char *name, bool recur)
     OPENDIR(baseDirectory, baseDir);
     sector = baseDirectory->Find(filename); // Find if the file exist
     
-    if (sector == -1 || sector == DirectorySector) {
+    if (sector == -1 || sector == DirectorySector
+				|| kernel->headerTable->IsHeld(sector)) {
         delete baseDirectory;
         delete baseDir;
+        lock->Release();
         return FALSE;
     }
   
-    freeMap = new PersistentBitmap(freeMapFile,NumSectors);
-    
+    dentryCache->Invalidate(name);		// before its sectors are freed
+    journal->Begin();
     if(recur) {
         tarDir = new OpenFile(sector);
         OPENDIR(targetDirectory, tarDir);
-        targetDirectory->Destroy(freeMap, name, tarDir); // Recursively destroy the directory
+        destroyed = targetDirectory->Destroy(freeMap, name); // Recursively destroy the directory
         delete targetDirectory;
         delete tarDir;
+        if (!destroyed) {
+            freeMap->Revert();		// something below is still open
+            journal->End();
+            delete baseDirectory;
+            delete baseDir;
+            lock->Release();
+            return FALSE;
+        }
     }
    
     fileHdr = new FileHeader;
@@ -337,11 +561,12 @@ FileSystem::Remove(char *name, bool recur)
 
     freeMap->WriteBack(freeMapFile);		// flush to disk
     baseDirectory->WriteBack(baseDir);        // flush to disk
+    journal->End();
     
     delete baseDirectory;
     delete baseDir;
     delete fileHdr;
-    delete freeMap;
+    lock->Release();
     return TRUE;
 } 
 
@@ -353,25 +578,28 @@ FileSystem::Remove(char *name, bool recur)
 void
 FileSystem::List(char *path, bool recur)
 {
-    Directory *rootDirectory = new Directory(NumDirEntries);
     int sector;
-    rootDirectory->FetchFrom(directoryFile);
-    sector = rootDirectory->SearchPath(path, 0);
 
-    
-    if(sector == DirectorySector)
+    lock->Acquire();
+    sector = LookupPath(path);
+    if (sector == -1) {
+        lock->Release();
+        return;				// no such directory
+    }
+    if(sector == DirectorySector) {
+        Directory *rootDirectory = new Directory(NumDirBlocks);
+        rootDirectory->FetchFrom(directoryFile);
         rootDirectory->List(NULL, recur);
-    else {
+        delete rootDirectory;
+    } else {
         OpenFile* file = new OpenFile(sector);
-        Directory *targetDirectory = new Directory(NumDirEntries);
+        Directory *targetDirectory = new Directory(NumDirBlocks);
         targetDirectory->FetchFrom(file);
         targetDirectory->List(path, recur);
         delete targetDirectory;
         delete file;
     }
-
-
-    delete rootDirectory;
+    lock->Release();
 }
 
 
@@ -394,17 +622,14 @@ FileSystem::RecursiveList(char *path)
 void
 FileSystem::Print()
 {
-    FileHeader *bitHdr = new FileHeader;
-    FileHeader *dirHdr = new FileHeader;
-    PersistentBitmap *freeMap = new PersistentBitmap(freeMapFile,NumSectors);
-    Directory *directory = new Directory(NumDirEntries);
+    FileHeader *bitHdr = kernel->headerTable->Acquire(FreeMapSector);
+    FileHeader *dirHdr = kernel->headerTable->Acquire(DirectorySector);
+    Directory *directory = new Directory(NumDirBlocks);
 
     printf("Bit map file header:\n");
-    bitHdr->FetchFrom(FreeMapSector);
     bitHdr->Print();
 
     printf("Directory file header:\n");
-    dirHdr->FetchFrom(DirectorySector);
     dirHdr->Print();
 
     freeMap->Print();
@@ -412,58 +637,242 @@ FileSystem::Print()
     directory->FetchFrom(directoryFile);
     directory->Print();
 
-    delete bitHdr;
-    delete dirHdr;
-    delete freeMap;
+    kernel->headerTable->Release(FreeMapSector);
+    kernel->headerTable->Release(DirectorySector);
     delete directory;
 } 
 
+//----------------------------------------------------------------------
+// FileSystem::Sync
+// 	Write every change held in the disk cache back to the disk, and
+//	empty the journal, so that the next time Nachos starts there is
+//	nothing to replay.  Called when Nachos halts.
+//----------------------------------------------------------------------
+
+void
+FileSystem::Sync()
+{
+    journal->Checkpoint();
+} 
+
+//----------------------------------------------------------------------
+// FileSystem::OpenFileForId
+// 	Open the file "name" for a user program, and return its id: its
+//	slot in the table of files opened by user programs.  The free
+//	slots are kept on a list, so finding one takes no search.
+//
+//	Return -1 if there is no such file, or the table is full.
+//
+//	"name" -- the text name of the file to be opened
+//----------------------------------------------------------------------
+
 OpenFileId 
 FileSystem::OpenFileForId(char *name)
 {
-    int fd = 0;
-    OpenFile* file = this->Open(name);
+    OpenFile* file;
+    OpenFileId id;
     
-    while(fd <= MAX_SYS_OPENF) {
-        fd ++;
-        if(!SysWideOpenFileTable[fd]) {
-            SysWideOpenFileTable[fd] = file;
-            break;
-        }
-    }
-    ASSERT(fd <= MAX_SYS_OPENF);
+    if (freeIds == -1)
+        return -1;			// too many files open
+    file = Open(name);
+    if (file == NULL)
+        return -1;			// file not found
+    id = freeIds;
+    freeIds = nextFreeId[id];
+    SysWideOpenFileTable[id] = file;
+    return id;
+}
+
+//----------------------------------------------------------------------
+// FileSystem::FileForId
+// 	Return the file a user program opened as "id", or NULL if "id"
+//	is not an open file.
+//----------------------------------------------------------------------
 
-    return fd;
+OpenFile *
+FileSystem::FileForId(OpenFileId id)
+{
+    if (id < 0 || id >= MAX_SYS_OPENF)
+        return NULL;
+    return SysWideOpenFileTable[id];
 }
 
+//----------------------------------------------------------------------
+// FileSystem::WriteToFileId
+// FileSystem::ReadFromFileId
+// 	Write/read "size" bytes of the file "id", at its seek position,
+//	and move the seek position past them.  Return the number of
+//	bytes written or read, or -1 if "id" is not an open file.
+//----------------------------------------------------------------------
+
 int 
 FileSystem::WriteToFileId(char *buf, int size, OpenFileId id)
 {
-    OpenFile* file = SysWideOpenFileTable[id];
+    OpenFile* file = FileForId(id);
+
+    if (file == NULL)
+        return -1;
     return file->Write(buf, size);
 }
 
 int 
 FileSystem::ReadFromFileId(char *buf, int size, OpenFileId id)
 {
-    OpenFile* file = SysWideOpenFileTable[id];
+    OpenFile* file = FileForId(id);
+
+    if (file == NULL)
+        return -1;
     return file->Read(buf, size);
 }
 
+//----------------------------------------------------------------------
+// FileSystem::WriteAtFileId
+// FileSystem::ReadAtFileId
+// 	Write/read "size" bytes of the file "id", starting at byte
+//	"position", without using or moving its seek position.  Return
+//	the number of bytes written or read, or -1 if "id" is not an
+//	open file.
+//----------------------------------------------------------------------
+
+int 
+FileSystem::WriteAtFileId(char *buf, int size, int position, OpenFileId id)
+{
+    OpenFile* file = FileForId(id);
+
+    if (file == NULL || position < 0)
+        return -1;
+    return file->WriteAt(buf, size, position);
+}
+
+int 
+FileSystem::ReadAtFileId(char *buf, int size, int position, OpenFileId id)
+{
+    OpenFile* file = FileForId(id);
+
+    if (file == NULL || position < 0)
+        return -1;
+    return file->ReadAt(buf, size, position);
+}
+
+//----------------------------------------------------------------------
+// FileSystem::SeekFileId
+// 	Move the seek position of the file "id" to byte "position".
+//	Return 1 on success, or -1 if "id" is not an open file.
+//----------------------------------------------------------------------
+
+int 
+FileSystem::SeekFileId(int position, OpenFileId id)
+{
+    OpenFile* file = FileForId(id);
+
+    if (file == NULL || position < 0)
+        return -1;
+    file->Seek(position);
+    return 1;
+}
+
+//----------------------------------------------------------------------
+// FileSystem::CloseFileId
+// 	Close the file "id", and put its slot back on the free list.
+//	Return 1 on success, or 0 if "id" is not an open file.
+//----------------------------------------------------------------------
+
 int 
 FileSystem::CloseFileId(OpenFileId id)
 {
-    OpenFile* file = SysWideOpenFileTable[id];
+    OpenFile* file = FileForId(id);
     
     if(file == NULL)
         return 0;
     delete file;
 
     SysWideOpenFileTable[id] = NULL;
+    nextFreeId[id] = freeIds;
+    freeIds = id;
     
     return 1;
 }
 
+//----------------------------------------------------------------------
+// FileSystem::LookupPath
+// 	Return the sector of the file header of the file or directory
+//	named by "path", or -1 if there is no such file.
+//
+//	Each component of the path is looked up in the directory named
+//	by the components before it.  As in the directories themselves,
+//	a component includes its leading '/', so "/t0/bb/f3" is "/t0",
+//	then "/bb", then "/f3".
+//
+//	Every path found, and every leading part of it, is put in the
+//	dentry cache.  The walk starts from the longest leading part of
+//	"path" that is in the cache, so looking up a path a second time
+//	reads no directories at all.
+//
+//	"path" -- the full path name, starting from the root
+//----------------------------------------------------------------------
+
+int
+FileSystem::LookupPath(char *path)
+{
+    char prefix[MAX_PATH_LEN + 1];
+    char component[FileNameMaxLen + 1];
+    Directory *directory;
+    OpenFile *dirFile;
+    int sector, length, start, end, cached;
+    char c;
+
+    if (path[0] == '\0' || path[1] == '\0')
+        return DirectorySector;		// the root
+    sector = dentryCache->Lookup(path);
+    if (sector != -1)
+        return sector;
+
+    strncpy(prefix, path, MAX_PATH_LEN);
+    prefix[MAX_PATH_LEN] = '\0';
+    length = strlen(prefix);
+
+    // find the longest leading part of the path we already know
+    sector = DirectorySector;
+    start = 0;
+    for (end = length - 1; end > 0; end--) {
+        if (prefix[end] != '/')
+            continue;
+        prefix[end] = '\0';
+        cached = dentryCache->Lookup(prefix);
+        prefix[end] = '/';
+        if (cached != -1) {
+            sector = cached;
+            start = end;
+            break;
+        }
+    }
+
+    // and look up the rest, one directory at a time
+    while (start < length) {
+        for (end = start + 1; end < length && prefix[end] != '/'; end++)
+            ;
+        strncpy(component, &prefix[start], min(end - start, FileNameMaxLen));
+        component[min(end - start, FileNameMaxLen)] = '\0';
+
+        dirFile = (sector == DirectorySector) ? directoryFile
+						: new OpenFile(sector);
+        OPENDIR(directory, dirFile);
+        sector = directory->Find(component);
+        delete directory;
+        if (dirFile != directoryFile)
+            delete dirFile;
+        if (sector == -1)
+            return -1;
+
+        c = prefix[end];
+        prefix[end] = '\0';
+        dentryCache->Insert(prefix, sector);
+        prefix[end] = c;
+        start = end;
+    }
+    return sector;
+}
+
 void
 FileSystem::ExtractBasePath(char *base, char *name, char *abs)
 {
@@ -476,9 +885,12 @@ FileSystem::ExtractBasePath(char *base, char *name, char *abs)
 
     for(i = 0; i < mark; i ++)
         base[i] = abs[i];
+    if(mark == 0)       // in the root directory
+        base[i++] = '/';
     base[i] = '\0';
 
-    for(i = mark; abs[i]; i++)
+    // a name that is too long is cut short, as in LookupPath
+    for(i = mark; abs[i] && j < FileNameMaxLen; i++)
         name[j++] = abs[i];
     name[j] = '\0';
 }
@@ -42,15 +42,38 @@ typedef int OpenFileId;
 // sectors, so that they can be located on boot-up.
 #define FreeMapSector 		0
 #define DirectorySector 	1
-
-// Initial file sizes for the bitmap and directory; until the file system
-// supports extensible files, the directory size sets the maximum number 
-// of files that can be loaded onto the disk.
-#define FreeMapFileSize 	(NumSectors / BitsInByte)
-#define NumDirEntries 		64  //to support (3)
-#define DirectoryFileSize 	(sizeof(DirectoryEntry) * NumDirEntries)
+#define JournalSector 		2	// where the metadata log is
+#define JournalSize 		max(NumSectors / 16, \
+				    Journal::LogBlocks(MaxTransactionSectors))
+					// # of sectors in the log; there is
+					// always room for the biggest
+					// transaction, however small the disk
+
+// The most sectors one transaction can change: a Create that splits
+// MaxSplits directory blocks (see FileSystem::MakeRoom) changes the
+// first block, and the blocks split and split into; it also changes
+// the new directory's first block, the headers and extent blocks of
+// the new file and of its directory, and the free map.
+#define MaxTransactionSectors	((2 * MaxSplits + 2) * DirBlockSectors + \
+				    2 * (1 + NumExtentBlocks) + \
+				    divRoundUp(FreeMapFileSize, SectorSize))
+
+// Initial file sizes for the bitmap and directory; directories start
+// out one directory block long, and grow as files are added to them.
+#define FreeMapFileSize 	(divRoundUp(NumSectors, BitsInWord) * \
+					sizeof(unsigned int))
+#define NumDirBlocks 		1
+#define DirectoryFileSize 	(NumDirBlocks * DirBlockSize)
 #define MAX_PATH_LEN 255
-#define OPENDIR(dir,opf)  dir=new Directory(NumDirEntries);dir->FetchFrom(opf)
+
+// To keep related sectors close together, the disk is divided into
+// groups of a few tracks each.  A file is placed in the group of the
+// directory it is in; each new directory goes in the group with the
+// most free space.
+#define TracksPerGroup		4
+#define SectorsPerGroup		(TracksPerGroup * SectorsPerTrack)
+#define NumGroups		divRoundUp(NumSectors, SectorsPerGroup)
+#define OPENDIR(dir,opf)  dir=new Directory(NumDirBlocks);dir->FetchFrom(opf)
 
 #ifdef FILESYS_STUB 		// Temporarily implement file system calls as 
 				// calls to UNIX, until the real file system
@@ -81,6 +104,19 @@ class FileSystem {
 };
 
 #else // FILESYS
+class DentryCache;
+class PersistentBitmap;
+class Journal;
+class Lock;
+class Directory;
+
+// Only one thread at a time may change file headers, directories or
+// the bitmap: Create, Remove and ExtendFile each hold the file
+// system's lock from start to finish, journal commit included, so
+// that the next operation finds their changes in the sector cache.
+// Open and List hold it too, so that they never see a directory that
+// is half-way through growing.
+
 class FileSystem {
   public:
     FileSystem(bool format);		// Initialize the file system.
@@ -97,6 +133,14 @@ class FileSystem {
 
     OpenFile* Open(char *name); 	// Open a file (UNIX open)
 
+    bool ExtendFile(FileHeader *hdr, int hdrSector, int position,
+					int newSize);
+					// Grow an open file, allocating
+					// data blocks for it
+    void WriteHeader(FileHeader *hdr, int hdrSector);
+					// Write back an open file's header,
+					// as a journal transaction
+
     bool Remove(char *name, bool recur);  		// Delete a file (UNIX unlink)
     bool RecursiveRemove(char *path);  		// Delete a file (UNIX unlink)
 
@@ -104,20 +148,52 @@ class FileSystem {
     void RecursiveList(char *path);			// List all the files in the file system
 
     void Print();			// List all the files and their contents
+    void Sync();			// Write all changes home, and empty
+					// the journal
+
+    // Files opened by user programs are kept in a table shared by
+    // every address space, and named by their slot in it; each
+    // address space maps its own descriptors onto these ids (see
+    // addrspace.h).  Every open has its own seek position; the
+    // *At routines read and write at a given position instead, and
+    // leave the seek position alone.
     OpenFileId OpenFileForId(char *name);
     int WriteToFileId(char *buf, int size, OpenFileId id);
     int ReadFromFileId(char *buf, int size, OpenFileId id);
+    int WriteAtFileId(char *buf, int size, int position, OpenFileId id);
+    int ReadAtFileId(char *buf, int size, int position, OpenFileId id);
+    int SeekFileId(int position, OpenFileId id);
     int CloseFileId(OpenFileId id);
 
     void ExtractBasePath(char *base, char *name, char *abs);
 
   private:
+   int LookupPath(char *path);		// Find the header sector of the
+					// file "path" names, -1 if none
+   int PlaceHeader(int dirSector, bool isDir);
+					// Where to look for a sector for a
+					// new file header
+   bool MakeRoom(Directory *directory, OpenFile *dirFile, char *name);
+					// Split a directory's blocks until
+					// there is room for "name"
+
    OpenFile* freeMapFile;		// Bit map of free disk blocks,
 					// represented as a file
+   PersistentBitmap *freeMap;		// In-memory copy of the bit map,
+					// kept for as long as Nachos runs
    OpenFile* directoryFile;		// "Root" directory -- list of 
 					// file names, represented as a file
+   DentryCache *dentryCache;		// Recently looked up paths
+   Journal *journal;			// Log of metadata changes
+   Lock *lock;				// One operation at a time changes
+					// the metadata
    
    OpenFile* SysWideOpenFileTable[MAX_SYS_OPENF];
+					// Files opened by user programs
+   int nextFreeId[MAX_SYS_OPENF];	// Chains the free slots of the table
+   int freeIds;				// First free slot, -1 if it is full
+
+   OpenFile *FileForId(OpenFileId id);	// The open file "id", or NULL
 };
 
 #endif // FILESYS
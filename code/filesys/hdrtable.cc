@@ -0,0 +1,128 @@
+// hdrtable.cc
+//	Routines to manage the table of file headers in memory.  See
+//	hdrtable.h for how the table is organized, and openfile.cc for
+//	how it is used.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "debug.h"
+#include "filehdr.h"
+#include "hdrtable.h"
+
+//----------------------------------------------------------------------
+// HeaderTable::HeaderTable
+// 	Initialize an empty table of file headers.
+//----------------------------------------------------------------------
+
+HeaderTable::HeaderTable()
+{
+    for (int i = 0; i < HeaderTableBuckets; i++)
+	buckets[i] = NULL;
+}
+
+//----------------------------------------------------------------------
+// HeaderTable::~HeaderTable
+// 	De-allocate the table, along with any headers that are still
+//	being held.
+//----------------------------------------------------------------------
+
+HeaderTable::~HeaderTable()
+{
+    HeaderEntry *entry, *next;
+
+    for (int i = 0; i < HeaderTableBuckets; i++)
+	for (entry = buckets[i]; entry != NULL; entry = next) {
+	    next = entry->hashNext;
+	    delete entry->hdr;
+	    delete entry;
+	}
+}
+
+//----------------------------------------------------------------------
+// HeaderTable::Find
+// 	Return the entry holding the header stored at "sector", or NULL
+//	if no one is holding that header.
+//
+//	"sector" -- the disk sector of the file header
+//----------------------------------------------------------------------
+
+HeaderEntry *
+HeaderTable::Find(int sector)
+{
+    HeaderEntry *entry;
+
+    for (entry = buckets[HashValue(sector)]; entry != NULL;
+					entry = entry->hashNext)
+	if (entry->sector == sector)
+	    return entry;
+    return NULL;
+}
+
+//----------------------------------------------------------------------
+// HeaderTable::Acquire
+// 	Return the in-memory copy of the file header stored at "sector",
+//	and count one more user of it.  If no one else is holding the
+//	header, read it from disk.  Every call must be matched by a
+//	Release.
+//
+//	Reading the header may block; if another thread brings the same
+//	header in meanwhile, the copy we read is thrown away, so that
+//	there is never more than one copy.
+//
+//	"sector" -- the disk sector of the file header
+//----------------------------------------------------------------------
+
+FileHeader *
+HeaderTable::Acquire(int sector)
+{
+    HeaderEntry *entry = Find(sector);
+    FileHeader *hdr;
+
+    if (entry == NULL) {
+	hdr = new FileHeader;
+	hdr->FetchFrom(sector);
+	entry = Find(sector);		// did someone beat us to it?
+	if (entry != NULL)
+	    delete hdr;
+	else {
+	    DEBUG(dbgFile, "Reading file header at sector " << sector);
+	    entry = new HeaderEntry;
+	    entry->sector = sector;
+	    entry->hdr = hdr;
+	    entry->refCount = 0;
+	    entry->hashNext = buckets[HashValue(sector)];
+	    buckets[HashValue(sector)] = entry;
+	}
+    }
+    entry->refCount++;
+    return entry->hdr;
+}
+
+//----------------------------------------------------------------------
+// HeaderTable::Release
+// 	Count one less user of the file header stored at "sector".  When
+//	there are none left, delete the in-memory copy; any changes to it
+//	must already have been written back.
+//
+//	"sector" -- the disk sector of the file header
+//----------------------------------------------------------------------
+
+void
+HeaderTable::Release(int sector)
+{
+    HeaderEntry **ptr = &buckets[HashValue(sector)];
+    HeaderEntry *entry;
+
+    while (*ptr != NULL && (*ptr)->sector != sector)
+	ptr = &(*ptr)->hashNext;
+    entry = *ptr;
+    ASSERT(entry != NULL && entry->refCount > 0);
+    if (--entry->refCount == 0) {
+	*ptr = entry->hashNext;
+	delete entry->hdr;
+	delete entry;
+    }
+}
@@ -0,0 +1,68 @@
+// hdrtable.h
+//	Data structures for the table of file headers in memory.
+//
+//	Every open file needs its file header, to find where its data
+//	is on disk.  Rather than each OpenFile reading its own copy,
+//	the file system keeps one copy of the header of each file that
+//	is open, shared by every OpenFile of that file.  Opening a file
+//	that is already open costs no disk reads, and when one OpenFile
+//	extends the file, the others see the new length and sectors at
+//	once.  In UNIX terms, this is the "in-core inode table".
+//
+//	Each header has a count of the OpenFiles (and other users)
+//	holding it.  When the last one lets go, the header is deleted;
+//	its sector is still likely to be in the sector cache, if the
+//	file is opened again soon.
+//
+//	As with the sector cache, a small chained hash table is used to
+//	find the header kept for a sector.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+
+#ifndef HDRTABLE_H
+#define HDRTABLE_H
+
+class FileHeader;
+
+#define HeaderTableBuckets	64	// number of hash chains in the table
+
+// The following class defines one file header held in memory.
+
+class HeaderEntry {
+  public:
+    int sector;				// Where the header is on disk
+    FileHeader *hdr;			// The shared in-memory copy
+    int refCount;			// How many users are holding it
+    HeaderEntry *hashNext;		// Next entry in the same hash bucket
+};
+
+// The following class defines the table of file headers in memory.
+
+class HeaderTable {
+  public:
+    HeaderTable();			// Initialize an empty table
+    ~HeaderTable();			// De-allocate the table, and any
+					// headers still in it
+
+    FileHeader *Acquire(int sector);	// Return the header stored at
+					// "sector", reading it from disk
+					// if no one else is holding it
+    void Release(int sector);		// Let go of the header at "sector";
+					// it is deleted once no one holds it
+    bool IsHeld(int sector) { return Find(sector) != NULL; }
+					// Is anyone holding the header at
+					// "sector" (is the file open)?
+
+  private:
+    HeaderEntry *buckets[HeaderTableBuckets];
+					// Hash chains, keyed by sector
+
+    int HashValue(int sector) { return sector % HeaderTableBuckets; }
+    HeaderEntry *Find(int sector);	// Entry for "sector", or NULL
+};
+
+#endif // HDRTABLE_H
@@ -0,0 +1,744 @@
+// journal.cc
+//	Routines to manage the metadata journal.  See journal.h for how
+//	the log is laid out, and filesys.cc for which operations are
+//	made transactions.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "journal.h"
+#include "bitmap.h"
+#include "synchdisk.h"
+#include "synch.h"
+#include "main.h"
+
+//----------------------------------------------------------------------
+// Transaction::Transaction
+// 	Initialize an empty transaction.
+//
+//	"thread" -- the thread making the changes, or NULL for a group
+//		of ended transactions
+//----------------------------------------------------------------------
+
+Transaction::Transaction(Thread *thread)
+{
+    owner = thread;
+    depth = 0;
+    records = new List<LogRecord *>;
+}
+
+//----------------------------------------------------------------------
+// Transaction::~Transaction
+// 	De-allocate a transaction, and the sector images in it.
+//----------------------------------------------------------------------
+
+Transaction::~Transaction()
+{
+    while (!records->IsEmpty())
+	delete records->RemoveFront();
+    delete records;
+}
+
+//----------------------------------------------------------------------
+// Transaction::Find
+// 	Return the record of "sector" in this transaction, or NULL if
+//	the transaction hasn't changed or freed it.
+//----------------------------------------------------------------------
+
+LogRecord *
+Transaction::Find(int sector)
+{
+    ListIterator<LogRecord *> iter(records);
+
+    for (; !iter.IsDone(); iter.Next())
+	if (iter.Item()->sector == sector)
+	    return iter.Item();
+    return NULL;
+}
+
+//----------------------------------------------------------------------
+// Transaction::Add
+// 	Record a new image of a sector, replacing any earlier one.
+//
+//	"sector" -- the sector that was changed
+//	"data" -- its new contents
+//----------------------------------------------------------------------
+
+void
+Transaction::Add(int sector, char *data)
+{
+    LogRecord *record = Find(sector);
+
+    if (record == NULL) {
+	record = new LogRecord;
+	record->sector = sector;
+	records->Append(record);
+    }
+    record->revoked = FALSE;
+    bcopy(data, record->data, SectorSize);
+}
+
+//----------------------------------------------------------------------
+// Transaction::Revoke
+// 	Record that a sector was freed, replacing any image of it.
+//
+//	"sector" -- the sector that was freed
+//----------------------------------------------------------------------
+
+void
+Transaction::Revoke(int sector)
+{
+    LogRecord *record = Find(sector);
+
+    if (record == NULL) {
+	record = new LogRecord;
+	record->sector = sector;
+	records->Append(record);
+    }
+    record->revoked = TRUE;
+}
+
+//----------------------------------------------------------------------
+// Transaction::Merge
+// 	Add every record of "other" to this transaction.  Where both
+//	have changed a sector, other's record wins.
+//----------------------------------------------------------------------
+
+void
+Transaction::Merge(Transaction *other)
+{
+    ListIterator<LogRecord *> iter(other->records);
+
+    for (; !iter.IsDone(); iter.Next())
+	if (iter.Item()->revoked)
+	    Revoke(iter.Item()->sector);
+	else
+	    Add(iter.Item()->sector, iter.Item()->data);
+}
+
+//----------------------------------------------------------------------
+// Journal::Journal
+// 	Initialize the in-memory state of a journal.  Nothing is read
+//	from the disk until Format or Recover is called.
+//
+//	"sector" -- the well-known sector holding the journal's info
+//----------------------------------------------------------------------
+
+Journal::Journal(int sector)
+{
+    infoSector = sector;
+    logStart = logSize = head = 0;
+    sequence = 1;
+    lock = new Lock("journal lock");
+    changed = new Condition("journal commit");
+    active = new List<Transaction *>;
+    pending = new Transaction(NULL);
+    pendingBatch = 1;
+    committing = NULL;
+    committedBatch = 0;
+    busy = FALSE;
+    inLog = new Bitmap(NumSectors);
+}
+
+//----------------------------------------------------------------------
+// Journal::~Journal
+// 	De-allocate the in-memory state of the journal.  Does no I/O;
+//	the disk may already be gone.
+//----------------------------------------------------------------------
+
+Journal::~Journal()
+{
+    while (!active->IsEmpty())
+	delete active->RemoveFront();
+    delete active;
+    delete pending;
+    delete inLog;
+    delete changed;
+    delete lock;
+}
+
+//----------------------------------------------------------------------
+// Journal::Format
+// 	Set up an empty log on a newly formatted disk.  The log's
+//	sectors must already be marked in use in the free map.
+//
+//	"start" -- the first sector of the log
+//	"size" -- how many sectors it has
+//----------------------------------------------------------------------
+
+void
+Journal::Format(int start, int size)
+{
+    char zero[SectorSize];
+
+    ASSERT(size >= LogBlocks(1));
+    logStart = start;
+    logSize = size;
+    head = 0;
+    sequence = 1;
+
+    // make sure whatever was in the log before isn't taken for a group
+    bzero(zero, SectorSize);
+    kernel->synchDisk->WriteSectors(logStart, 1, zero, FALSE);
+    WriteInfo();
+}
+
+//----------------------------------------------------------------------
+// Journal::Recover
+// 	Read where the log is from the info sector, and replay every
+//	group that was committed to it: write each sector image in the
+//	group to its home sector.  A group without a commit block (the
+//	log write was cut short) is ignored.  Then empty the log.
+//
+//	Replaying a group that was already written home does no harm;
+//	the same images are just written again.  The log is read twice:
+//	first to find the revoke records, so that no image of a sector
+//	is replayed if a later group freed it.
+//
+//	Return FALSE, without touching the disk, if the info sector does
+//	not describe a log: the disk was formatted before there was a
+//	journal, or is not a Nachos file system at all.
+//----------------------------------------------------------------------
+
+bool
+Journal::Recover()
+{
+    char buf[SectorSize];
+    JournalInfo *info = (JournalInfo *) buf;
+    int *revoked;
+    int replayed;
+
+    kernel->synchDisk->ReadSector(infoSector, buf);
+    if (info->magic != JournalMagic || info->start <= infoSector
+		|| info->size < LogBlocks(1)
+		|| info->start + info->size > NumSectors)
+	return FALSE;
+    logStart = info->start;
+    logSize = info->size;
+    sequence = info->sequence;
+
+    revoked = new int[NumSectors];
+    for (int i = 0; i < NumSectors; i++)
+	revoked[i] = 0;			// no group is numbered 0
+    (void) ReplayLog(revoked, FALSE);
+    replayed = ReplayLog(revoked, TRUE);
+    delete [] revoked;
+    DEBUG(dbgFile, "Journal replayed " << replayed << " groups");
+
+    sequence += replayed;
+    if (head > 0)
+	sequence++;		// skip over any half-written group
+    Empty();
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// Journal::ReplayLog
+// 	Step through the committed groups in the log, from the start,
+//	stopping at the first block that is not part of one.  Return
+//	how many there are, with "head" set to where the scan stopped.
+//
+//	"revoked" -- for each sector, the number of the last group that
+//		freed it, 0 if none; filled in on the first pass
+//	"replay" -- FALSE on the first pass; TRUE on the second, which
+//		writes each image home, unless a later group freed
+//		its sector
+//----------------------------------------------------------------------
+
+int
+Journal::ReplayLog(int *revoked, bool replay)
+{
+    char buf[SectorSize];
+    char data[SectorSize];
+    LogBlock *block = (LogBlock *) buf;
+    Transaction *group = new Transaction(NULL);
+    int sectors[LogBlockSectors];
+    int count, groups = 0;
+
+    for (head = 0; head < logSize; ) {
+	kernel->synchDisk->ReadSector(logStart + head, buf);
+	if (block->sequence != sequence + groups)
+	    break;			// left over from an earlier group
+	count = block->count;
+	if (block->magic == DescriptorMagic) {
+	    if (count > LogBlockSectors || head + 1 + count > logSize)
+		break;
+	    bcopy(block->sectors, sectors, count * sizeof(int));
+	    for (int i = 0; i < count && replay; i++)
+		if (revoked[sectors[i]] <= sequence + groups) {
+		    kernel->synchDisk->ReadSector(logStart + head + 1 + i,
+								data);
+		    group->Add(sectors[i], data);
+		}
+	    head += 1 + count;
+	} else if (block->magic == RevokeMagic) {
+	    if (count > LogBlockSectors)
+		break;
+	    for (int i = 0; i < count; i++)
+		group->Revoke(block->sectors[i]);
+	    head++;
+	} else if (block->magic == CommitMagic) {
+	    ListIterator<LogRecord *> iter(group->records);
+
+	    for (; !iter.IsDone(); iter.Next())
+		if (iter.Item()->revoked)
+		    revoked[iter.Item()->sector] = sequence + groups;
+		else
+		    kernel->synchDisk->WriteSectors(iter.Item()->sector, 1,
+						iter.Item()->data, TRUE);
+	    delete group;
+	    group = new Transaction(NULL);
+	    groups++;
+	    head++;
+	} else {
+	    break;
+	}
+    }
+    delete group;
+    return groups;
+}
+
+//----------------------------------------------------------------------
+// Journal::Begin
+// 	Start a transaction for the current thread.  Until the matching
+//	End, the thread's sector writes are collected by Log.  Begin
+//	and End may be nested; only the outermost End commits.
+//----------------------------------------------------------------------
+
+void
+Journal::Begin()
+{
+    Transaction *trans;
+
+    lock->Acquire();
+    trans = Current();
+    if (trans == NULL) {
+	trans = new Transaction(kernel->currentThread);
+	active->Append(trans);
+    }
+    trans->depth++;
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// Journal::End
+// 	End the current thread's transaction, and return once it is
+//	committed to the log.
+//
+//	The transaction is merged into the pending group.  If no thread
+//	is writing to the log, this one takes the pending group and
+//	writes it; otherwise it waits, and the pending group (with any
+//	other transactions that end meanwhile) is written by whichever
+//	thread gets to the log next.
+//
+//	In write-back mode, the pending group is left for the flush
+//	daemon to commit (see Commit), and End returns right away,
+//	unless the group has grown as big as the log can take.
+//----------------------------------------------------------------------
+
+void
+Journal::End()
+{
+    Transaction *trans;
+
+    lock->Acquire();
+    trans = Current();
+    ASSERT(trans != NULL);
+    if (--trans->depth > 0 || trans->records->IsEmpty()) {
+	if (trans->depth == 0) {
+	    active->Remove(trans);
+	    delete trans;
+	}
+	lock->Release();
+	return;
+    }
+    active->Remove(trans);
+
+    // a transaction that frees many sectors can have more revoke
+    // records than the log has room for; once the log is emptied,
+    // most of them are not needed
+    if (LogBlocks(trans->records->NumInList()) > logSize) {
+	Drain();
+	Trim(trans);
+    }
+
+    // a group must fit in the log
+    while (!pending->records->IsEmpty() &&
+	    LogBlocks(pending->records->NumInList() +
+			trans->records->NumInList()) > logSize)
+	CommitBatch(pendingBatch);
+    pending->Merge(trans);
+    delete trans;
+
+    if (kernel->synchDisk->IsWriteBack())
+	kernel->synchDisk->FlushLater();
+    else
+	CommitBatch(pendingBatch);
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// Journal::Commit
+// 	Commit the pending group, if there is one, and return once it is
+//	in the log.  Called by the flush daemon in write-back mode, where
+//	End leaves the pending group in memory.
+//----------------------------------------------------------------------
+
+void
+Journal::Commit()
+{
+    lock->Acquire();
+    if (!pending->records->IsEmpty())
+	CommitBatch(pendingBatch);
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// Journal::CommitBatch
+// 	Return once group number "batch" is committed.  If no thread is
+//	writing to the log, take the pending group and write it; else
+//	wait for the thread that is, and try again.  The caller must
+//	hold the lock.
+//
+//	"batch" -- the group to wait for; the pending one, or earlier
+//----------------------------------------------------------------------
+
+void
+Journal::CommitBatch(int batch)
+{
+    while (committedBatch < batch) {
+	if (busy) {
+	    changed->Wait(lock);
+	    continue;
+	}
+	committing = pending;
+	pending = new Transaction(NULL);
+	pendingBatch++;
+	busy = TRUE;
+	lock->Release();
+
+	WriteGroup(committing);
+
+	lock->Acquire();
+	delete committing;
+	committing = NULL;
+	busy = FALSE;
+	committedBatch = pendingBatch - 1;
+	changed->Broadcast(lock);
+    }
+}
+
+//----------------------------------------------------------------------
+// Journal::Log
+// 	Called by SynchDisk for every write.  If the current thread is
+//	in a transaction, add the sector images to the transaction
+//	instead of writing them, and return TRUE; otherwise return FALSE,
+//	and let the write go to the disk as usual.
+//
+//	"sectorNumber" -- the first sector being written
+//	"numSectors" -- how many consecutive sectors
+//	"data" -- their new contents, a buffer per sector
+//----------------------------------------------------------------------
+
+bool
+Journal::Log(int sectorNumber, int numSectors, char **data)
+{
+    Transaction *trans;
+
+    lock->Acquire();
+    trans = Current();
+    if (trans != NULL)
+	for (int i = 0; i < numSectors; i++)
+	    trans->Add(sectorNumber + i, data[i]);
+    lock->Release();
+    return (trans != NULL);
+}
+
+//----------------------------------------------------------------------
+// Journal::Overlay
+// 	Called by SynchDisk after every read, so that a thread in a
+//	transaction reads back what it wrote, rather than the old
+//	contents still on disk; and so that every thread sees what
+//	ended transactions wrote, though it has not yet been handed to
+//	the sector cache.  The newest image wins: the thread's own, then
+//	the pending group's, then that of the group being committed.
+//
+//	"sectorNumber" -- the first sector read
+//	"numSectors" -- how many consecutive sectors
+//	"data" -- their contents, as read, a buffer per sector
+//----------------------------------------------------------------------
+
+void
+Journal::Overlay(int sectorNumber, int numSectors, char **data)
+{
+    Transaction *trans;
+    LogRecord *record;
+
+    lock->Acquire();
+    trans = Current();
+    for (int i = 0; i < numSectors; i++) {
+	record = (trans == NULL) ? NULL : trans->Find(sectorNumber + i);
+	if (record == NULL)
+	    record = pending->Find(sectorNumber + i);
+	if (record == NULL && committing != NULL)
+	    record = committing->Find(sectorNumber + i);
+	if (record != NULL && !record->revoked)
+	    bcopy(record->data, data[i], SectorSize);
+    }
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// Journal::Revoke
+// 	Called when the current thread's transaction frees a sector.  If
+//	the log, or a transaction not yet logged, may hold an image of
+//	it, add a revoke record for it to the transaction, so that the
+//	image is neither replayed nor written home over whatever the
+//	sector is used for next.
+//
+//	"sector" -- the sector that was freed
+//----------------------------------------------------------------------
+
+void
+Journal::Revoke(int sector)
+{
+    Transaction *trans;
+
+    lock->Acquire();
+    trans = Current();
+    ASSERT(trans != NULL);
+    if (inLog->Test(sector) || trans->Find(sector) != NULL
+		|| pending->Find(sector) != NULL
+		|| (committing != NULL && committing->Find(sector) != NULL))
+	trans->Revoke(sector);
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// Journal::Checkpoint
+// 	Commit the pending group, and make sure every committed sector
+//	is written home, so that the log can be emptied.  Done at halt,
+//	so that the next mount has nothing to replay.  (When the log
+//	fills up, WriteGroup empties it too.)
+//----------------------------------------------------------------------
+
+void
+Journal::Checkpoint()
+{
+    lock->Acquire();
+    Drain();
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// Journal::Drain
+// 	Commit the pending group, then write everything home and empty
+//	the log, as for Checkpoint.  The caller must hold the lock.
+//----------------------------------------------------------------------
+
+void
+Journal::Drain()
+{
+    if (!pending->records->IsEmpty())
+	CommitBatch(pendingBatch);
+    while (busy)
+	changed->Wait(lock);
+    busy = TRUE;
+    lock->Release();
+
+    Empty();
+
+    lock->Acquire();
+    busy = FALSE;
+    changed->Broadcast(lock);
+}
+
+//----------------------------------------------------------------------
+// Journal::Trim
+// 	Throw away the revoke records of a transaction that are not
+//	needed: those of sectors of which neither the log nor the
+//	pending group holds an image.  The caller must hold the lock.
+//
+//	"trans" -- the transaction to trim
+//----------------------------------------------------------------------
+
+void
+Journal::Trim(Transaction *trans)
+{
+    List<LogRecord *> *kept = new List<LogRecord *>;
+    LogRecord *record;
+
+    while (!trans->records->IsEmpty()) {
+	record = trans->records->RemoveFront();
+	if (record->revoked && !inLog->Test(record->sector)
+			&& pending->Find(record->sector) == NULL)
+	    delete record;
+	else
+	    kept->Append(record);
+    }
+    delete trans->records;
+    trans->records = kept;
+}
+
+//----------------------------------------------------------------------
+// Journal::Current
+// 	Return the current thread's transaction, or NULL if it isn't in
+//	one.  The caller must hold the lock.
+//----------------------------------------------------------------------
+
+Transaction *
+Journal::Current()
+{
+    ListIterator<Transaction *> iter(active);
+
+    for (; !iter.IsDone(); iter.Next())
+	if (iter.Item()->owner == kernel->currentThread)
+	    return iter.Item();
+    return NULL;
+}
+
+//----------------------------------------------------------------------
+// Journal::LogBlocks
+// 	Return how many log sectors a group of "count" sector images
+//	takes: the images, their descriptor blocks, and a commit block.
+//----------------------------------------------------------------------
+
+int
+Journal::LogBlocks(int count)
+{
+    return divRoundUp(count, LogBlockSectors) + count + 1;
+}
+
+//----------------------------------------------------------------------
+// Journal::WriteGroup
+// 	Append a group of sector images and revoke records to the log,
+//	with a single disk request, emptying the log first if there
+//	isn't room.  Once the group is on disk, hand the images to the
+//	sector cache, to be written home whenever the cache gets around
+//	to it -- except for sectors that the pending group has freed
+//	since, which may already be in use for something else.  The
+//	caller must have set "busy".
+//----------------------------------------------------------------------
+
+void
+Journal::WriteGroup(Transaction *group)
+{
+    int count = 0, revokes = 0;
+    int blocks;
+    char *buf;
+    LogBlock *block = NULL;
+    LogRecord *record, *later;
+    int pos = 0;
+
+    for (ListIterator<LogRecord *> iter(group->records); !iter.IsDone();
+								iter.Next())
+	if (iter.Item()->revoked)
+	    revokes++;
+	else
+	    count++;
+    blocks = divRoundUp(count, LogBlockSectors) + count
+				+ divRoundUp(revokes, LogBlockSectors) + 1;
+    ASSERT(blocks <= logSize);
+    if (head + blocks > logSize)
+	Empty();
+
+    buf = new char[blocks * SectorSize];
+    bzero(buf, blocks * SectorSize);
+    for (ListIterator<LogRecord *> image(group->records); !image.IsDone();
+								image.Next()) {
+	record = image.Item();
+	if (record->revoked)
+	    continue;
+	if (block == NULL || block->count == LogBlockSectors) {
+	    block = (LogBlock *) &buf[pos++ * SectorSize];
+	    block->magic = DescriptorMagic;
+	    block->sequence = sequence;
+	    block->count = 0;
+	}
+	block->sectors[block->count++] = record->sector;
+	bcopy(record->data, &buf[pos++ * SectorSize], SectorSize);
+    }
+    block = NULL;
+    for (ListIterator<LogRecord *> revoke(group->records);
+					!revoke.IsDone(); revoke.Next()) {
+	record = revoke.Item();
+	if (!record->revoked)
+	    continue;
+	if (block == NULL || block->count == LogBlockSectors) {
+	    block = (LogBlock *) &buf[pos++ * SectorSize];
+	    block->magic = RevokeMagic;
+	    block->sequence = sequence;
+	    block->count = 0;
+	}
+	block->sectors[block->count++] = record->sector;
+    }
+    block = (LogBlock *) &buf[pos++ * SectorSize];
+    block->magic = CommitMagic;
+    block->sequence = sequence;
+    ASSERT(pos == blocks);
+
+    DEBUG(dbgFile, "Journal committing group " << sequence << ", " << count << " sectors, " << revokes << " revoked");
+    kernel->synchDisk->WriteSectors(logStart + head, blocks, buf, FALSE);
+    head += blocks;
+    sequence++;
+    delete [] buf;
+
+    lock->Acquire();
+    for (ListIterator<LogRecord *> home(group->records); !home.IsDone();
+								home.Next()) {
+	record = home.Item();
+	if (record->revoked) {
+	    inLog->Clear(record->sector);	// no image of it is replayed
+	    continue;
+	}
+	inLog->Mark(record->sector);
+	later = pending->Find(record->sector);
+	if (later == NULL || !later->revoked)
+	    kernel->synchDisk->WriteSectors(record->sector, 1, record->data,
+									TRUE);
+    }
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// Journal::Empty
+// 	Flush the sector cache, so that every group in the log has been
+//	written home, then start the log over.  The caller must have set
+//	"busy" (or be the only thread using the journal).
+//----------------------------------------------------------------------
+
+void
+Journal::Empty()
+{
+    kernel->synchDisk->Flush();
+    if (head > 0) {
+	head = 0;
+	WriteInfo();
+    }
+    lock->Acquire();
+    delete inLog;
+    inLog = new Bitmap(NumSectors);	// the log holds no images now
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// Journal::WriteInfo
+// 	Write where the log is, and the sequence number of the next
+//	group, to the journal's info sector.
+//----------------------------------------------------------------------
+
+void
+Journal::WriteInfo()
+{
+    char buf[SectorSize];
+    JournalInfo *info = (JournalInfo *) buf;
+
+    bzero(buf, SectorSize);
+    info->magic = JournalMagic;
+    info->start = logStart;
+    info->size = logSize;
+    info->sequence = sequence;
+    kernel->synchDisk->WriteSectors(infoSector, 1, buf, FALSE);
+}
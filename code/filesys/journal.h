@@ -0,0 +1,208 @@
+// journal.h
+//	Data structures for a write-ahead journal of file system metadata.
+//
+//	Creating or removing a file changes several sectors: the file
+//	header, the directory, the free map.  If Nachos crashes after
+//	only some of them have been written, the file system is left
+//	inconsistent.  Instead, each operation is made a transaction:
+//	the sectors it changes are collected in memory, and when it
+//	ends they are appended together to a log, a fixed run of
+//	sectors on disk, followed by a commit block.  Only once the
+//	commit block is on disk are the sectors written to their home
+//	locations; if Nachos crashes before that, Recover finds the
+//	committed transactions in the log when the disk is next mounted,
+//	and writes them again.
+//
+//	Since the log is on disk, the home writes need not happen right
+//	away: the changed sectors are left dirty in the sector cache,
+//	and written when they are replaced, or when the log fills up
+//	and has to be emptied (a checkpoint).  So each operation costs
+//	one sequential log write, instead of a write per sector changed.
+//
+//	Transactions that end while a log write is already under way
+//	are committed together by the next one (group commit).  In
+//	write-back mode, where a crash loses recent writes anyway, End
+//	does not wait for the log at all: ended transactions pile up in
+//	memory, and are committed as one group when the flush daemon
+//	next runs, or at a checkpoint.
+//
+//	Only metadata goes through the journal: file data is written
+//	outside of any transaction, as before.
+//
+//	When a sector is freed, older images of it may still be in the
+//	log, and once it is reused (perhaps for file data, which is not
+//	logged), replaying them would write over its new contents.  So
+//	the transaction that frees it carries a revoke record for it,
+//	which tells Recover to skip every image of it in earlier groups.
+//
+//	On disk, the log is a sequence of blocks.  Each committed group
+//	is one or more descriptor blocks, each followed by the sector
+//	images it describes, then any revoke blocks, then a commit
+//	block.  Every block of a group
+//	carries the group's sequence number, so that blocks left over
+//	from before the log was last emptied are not mistaken for new
+//	ones.  A well-known sector holds where the log is, and the
+//	sequence number of the first group in it.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include "disk.h"
+#include "list.h"
+
+class Bitmap;
+class Thread;
+class Lock;
+class Condition;
+
+#define JournalMagic	0x4a4e4c30	// Marks the journal's info sector
+#define DescriptorMagic	0x4a4e4c31	// Marks a descriptor block
+#define CommitMagic	0x4a4e4c32	// Marks a commit block
+#define RevokeMagic	0x4a4e4c33	// Marks a revoke block
+
+#define LogBlockSectors	((int)(SectorSize / sizeof(int)) - 3)
+					// How many sector images one
+					// descriptor block can describe
+
+// The following class defines the journal's info sector, which
+// says where the log is.
+
+class JournalInfo {
+  public:
+    int magic;				// JournalMagic
+    int start;				// First sector of the log
+    int size;				// Number of sectors in the log
+    int sequence;			// Sequence number of the first
+					// group in the log
+};
+
+// The following class defines a descriptor, revoke or commit block
+// in the log.  A descriptor block is followed by "count" sector
+// images, to be written to "sectors[0..count-1]".  A revoke block
+// lists "count" sectors that were freed; it has no images, and
+// neither does a commit block.
+
+class LogBlock {
+  public:
+    int magic;				// DescriptorMagic, RevokeMagic or
+					// CommitMagic
+    int sequence;			// Which group this block is part of
+    int count;				// Number of sector images following
+    int sectors[LogBlockSectors];	// Home sector of each image
+};
+
+// The following class defines a new image of a single sector,
+// waiting to be logged, or a revoke record for it.
+
+class LogRecord {
+  public:
+    int sector;				// Where the image belongs
+    bool revoked;			// Was the sector freed instead?
+    char data[SectorSize];		// The new contents of the sector,
+					// unless "revoked"
+};
+
+// The following class defines a transaction: the sectors changed so
+// far by a thread's file system operation, or by a group of
+// operations waiting to be committed together.  If the same sector
+// is changed twice, only the latest image is kept.
+
+class Transaction {
+  public:
+    Transaction(Thread *thread);	// Initialize an empty transaction
+    ~Transaction();			// De-allocate it, and its records
+
+    void Add(int sector, char *data);	// Record a new image of "sector"
+    void Revoke(int sector);		// Record that "sector" was freed
+    LogRecord *Find(int sector);	// The record of "sector", or NULL
+    void Merge(Transaction *other);	// Add all of other's records
+
+    Thread *owner;			// Thread making the changes, NULL
+					// for a group being committed
+    int depth;				// How many Begins without an End
+    List<LogRecord *> *records;		// The changed sectors
+};
+
+// The following class defines the journal.  A thread brackets the
+// metadata writes of each file system operation with Begin and End;
+// in between, SynchDisk hands its writes to Log instead of sending
+// them to the disk.  Overlay patches every read with the images not
+// yet handed to the sector cache: the thread's own, then those of
+// ended transactions, so that they are seen before they are logged.
+// End returns once the transaction is committed, or in write-back
+// mode, once it is merged into the pending group.
+
+class Journal {
+  public:
+    Journal(int sector);		// Initialize a journal, whose info
+					// is kept in "sector"
+    ~Journal();				// De-allocate the in-memory state
+
+    void Format(int start, int size);	// Make an empty log, in the "size"
+					// sectors starting at "start"
+    bool Recover();			// Replay the log, after a crash,
+					// then empty it; FALSE if the disk
+					// has no journal
+
+    void Begin();			// Start a transaction
+    void End();				// Commit it
+
+    bool Log(int sectorNumber, int numSectors, char **data);
+					// If the current thread is in a
+					// transaction, add these sector
+					// images to it, and return TRUE
+    void Overlay(int sectorNumber, int numSectors, char **data);
+					// Copy the images not yet in the
+					// sector cache over "data"
+    void Revoke(int sector);		// The current thread's transaction
+					// has freed "sector"
+
+    void Commit();			// Commit the ended transactions now
+    void Checkpoint();			// Write every committed sector home,
+					// and empty the log
+
+    static int LogBlocks(int count);	// Log sectors needed for "count"
+					// images
+
+  private:
+    int infoSector;			// Where the JournalInfo is kept
+    int logStart;			// First sector of the log
+    int logSize;			// Number of sectors in the log
+    int head;				// Where the next group goes, as an
+					// offset from logStart
+    int sequence;			// Sequence number of the next group
+
+    Lock *lock;				// Protects everything below
+    Condition *changed;			// Signalled when a commit finishes
+    List<Transaction *> *active;	// Transactions not yet ended
+    Transaction *pending;		// Ended transactions, waiting for
+					// the next commit
+    int pendingBatch;			// Number the pending group will get
+    Transaction *committing;		// Group being written to the log,
+					// NULL if none
+    int committedBatch;			// Number of the last group committed
+    bool busy;				// Is some thread writing to the log?
+    Bitmap *inLog;			// Sectors the log may hold images of
+
+    Transaction *Current();		// The current thread's transaction
+    void CommitBatch(int batch);	// Wait until group "batch" is
+					// committed, writing it if need be
+    void Drain();			// Checkpoint, with the lock held
+    void Trim(Transaction *trans);	// Drop the revoke records "trans"
+					// does not need
+    int ReplayLog(int *revoked, bool replay);
+					// Step through the groups in the
+					// log, for Recover
+    void WriteGroup(Transaction *group);// Log a group, then hand it to the
+					// sector cache
+    void Empty();			// Checkpoint, with "busy" held
+    void WriteInfo();			// Write the JournalInfo to disk
+};
+
+#endif // JOURNAL_H
@@ -15,32 +15,38 @@
 #include "copyright.h"
 #include "main.h"
 #include "filehdr.h"
+#include "hdrtable.h"
 #include "openfile.h"
 #include "synchdisk.h"
 
 //----------------------------------------------------------------------
 // OpenFile::OpenFile
 // 	Open a Nachos file for reading and writing.  Bring the file header
-//	into memory while the file is open.
+//	into memory while the file is open.  The header is shared with
+//	every other OpenFile of the same file (see hdrtable.h), so if the
+//	file is already open, no disk read is needed.
 //
 //	"sector" -- the location on disk of the file header for this file
 //----------------------------------------------------------------------
 
 OpenFile::OpenFile(int sector)
 { 
-    hdr = new FileHeader;
-    hdr->FetchFrom(sector);
+    hdr = kernel->headerTable->Acquire(sector);
+    hdrSector = sector;
     seekPosition = 0;
+    nextReadPosition = -1;		// no reads yet
+    readAheadEnd = 0;
 }
 
 //----------------------------------------------------------------------
 // OpenFile::~OpenFile
 // 	Close a Nachos file, de-allocating any in-memory data structures.
+//	The file header goes away with the last OpenFile of the file.
 //----------------------------------------------------------------------
 
 OpenFile::~OpenFile()
 {
-    delete hdr;
+    kernel->headerTable->Release(hdrSector);
 }
 
 //----------------------------------------------------------------------
@@ -99,11 +105,32 @@ OpenFile::Write(char *into, int numBytes)
 //	For ReadAt:
 //	   We read in all of the full or partial sectors that are part of the
 //	   request, but we only copy the part we are interested in.
+//	   Full sectors are read straight into "into"; only a partial
+//	   sector at either end goes through a sector buffer of our own.
 //	For WriteAt:
+//	   If the write goes past the end of the file, we first grow the
+//	   file, filling any gap between the old end and "position" with
+//	   zeroes.  If the disk is too full for that, the write is cut
+//	   off at the old end of the file.
 //	   We must first read in any sectors that will be partially written,
 //	   so that we don't overwrite the unmodified portion.  We then copy
 //	   in the data that will be modified, and write back all the full
-//	   or partial sectors that are part of the request.
+//	   or partial sectors that are part of the request.  As for ReadAt,
+//	   full sectors are written straight from "from".
+//
+//	Sectors of the file that are next to each other on disk are
+//	read/written with a single request (see NextRun), of up to
+//	TransferSectors sectors.
+//
+//	A ReadAt that starts where the last one left off is taken to be
+//	part of a sequential read of the file, so the sectors that follow
+//	it are read ahead (see ReadAhead).  A single read is not enough to
+//	go on, so the first ReadAt of an open file does not read ahead;
+//	looking up a name in a directory reads only the block it needs.
+//
+//	A small file kept inline in its header has no sectors: its data
+//	is copied to/from the header, which is written back on a write.
+//	Like any other data write, that is not a transaction of its own.
 //
 //	"into" -- the buffer to contain the data to be read from disk 
 //	"from" -- the buffer containing the data to be written to disk 
@@ -116,8 +143,9 @@ int
 OpenFile::ReadAt(char *into, int numBytes, int position)
 {
     int fileLength = hdr->FileLength();
-    int i, firstSector, lastSector, numSectors;
-    char *buf;
+    int i, firstSector, lastSector, runLength, tailStart;
+    char head[SectorSize], tail[SectorSize];
+    char *buffers[TransferSectors];
 
     if ((numBytes <= 0) || (position >= fileLength))
     	return 0; 				// check request
@@ -125,19 +153,35 @@ OpenFile::ReadAt(char *into, int numBytes, int position)
 	numBytes = fileLength - position;
     DEBUG(dbgFile, "Reading " << numBytes << " bytes at " << position << " from file of length " << fileLength);
 
+    if (hdr->IsInline()) {
+	hdr->ReadInline(into, numBytes, position);
+	return numBytes;
+    }
+
     firstSector = divRoundDown(position, SectorSize);
     lastSector = divRoundDown(position + numBytes - 1, SectorSize);
-    numSectors = 1 + lastSector - firstSector;
+    tailStart = lastSector * SectorSize;
 
     // read in all the full and partial sectors that we need
-    buf = new char[numSectors * SectorSize];
-    for (i = firstSector; i <= lastSector; i++)	
-        kernel->synchDisk->ReadSector(hdr->ByteToSector(i * SectorSize), 
-					&buf[(i - firstSector) * SectorSize]);
-
-    // copy the part we want
-    bcopy(&buf[position - (firstSector * SectorSize)], into, numBytes);
-    delete [] buf;
+    for (i = firstSector; i <= lastSector; i += runLength) {
+	runLength = NextRun(i, min(lastSector, i + TransferSectors - 1));
+	PlaceSectors(i, runLength, buffers, into, position, numBytes,
+							head, tail);
+        kernel->synchDisk->ReadSectors(hdr->ByteToSector(i * SectorSize), 
+			runLength, buffers);
+    }
+
+    // copy the part we want out of the partial sectors
+    if (position % SectorSize != 0)
+	bcopy(&head[position % SectorSize], into,
+		min(numBytes, SectorSize - position % SectorSize));
+    if (tailStart >= position && (position + numBytes) % SectorSize != 0)
+	bcopy(tail, &into[tailStart - position],
+					position + numBytes - tailStart);
+
+    if (position == nextReadPosition)
+	ReadAhead(lastSector + 1);
+    nextReadPosition = position + numBytes;
     return numBytes;
 }
 
@@ -145,46 +189,146 @@ int
 OpenFile::WriteAt(char *from, int numBytes, int position)
 {
     int fileLength = hdr->FileLength();
-    int i, firstSector, lastSector, numSectors;
+    int i, firstSector, lastSector, runLength, tailStart;
     bool firstAligned, lastAligned;
-    char *buf;
+    char head[SectorSize], tail[SectorSize];
+    char *buffers[TransferSectors];
 
-    if ((numBytes <= 0) || (position >= fileLength))
+    if (numBytes <= 0)
 	return 0;				// check request
-    if ((position + numBytes) > fileLength)
-	numBytes = fileLength - position;
+    if ((position + numBytes) > fileLength
+	    && !(hdr->IsInline() && (position + numBytes) <= InlineSize)) {
+	bool grown = kernel->fileSystem->ExtendFile(hdr, hdrSector,
+					position, position + numBytes);
+
+	fileLength = hdr->FileLength();
+	if (!grown) {
+	    if (position >= fileLength)
+		return 0;			// no room to grow the file
+	    numBytes = fileLength - position;
+	}
+    }
     DEBUG(dbgFile, "Writing " << numBytes << " bytes at " << position << " from file of length " << fileLength);
 
+    if (hdr->IsInline()) {
+	hdr->WriteInline(from, numBytes, position);
+	if (kernel->fileSystem != NULL)
+	    kernel->fileSystem->WriteHeader(hdr, hdrSector);	// journaled
+	else
+	    hdr->WriteBack(hdrSector);	// formatting; no journal yet
+	return numBytes;
+    }
+
     firstSector = divRoundDown(position, SectorSize);
     lastSector = divRoundDown(position + numBytes - 1, SectorSize);
-    numSectors = 1 + lastSector - firstSector;
-
-    buf = new char[numSectors * SectorSize];
-	
-	// Mp4 mod tag
-	memset(buf, 0, sizeof(char) * numSectors * SectorSize); // dummy operation to keep valgrind happy
+    tailStart = lastSector * SectorSize;
 
     firstAligned = (position == (firstSector * SectorSize));
     lastAligned = ((position + numBytes) == ((lastSector + 1) * SectorSize));
 
-// read in first and last sector, if they are to be partially modified
-    if (!firstAligned)
-        ReadAt(buf, SectorSize, firstSector * SectorSize);	
-    if (!lastAligned && ((firstSector != lastSector) || firstAligned))
-        ReadAt(&buf[(lastSector - firstSector) * SectorSize], 
-				SectorSize, lastSector * SectorSize);	
-
-// copy in the bytes we want to change 
-    bcopy(from, &buf[position - (firstSector * SectorSize)], numBytes);
-
-// write modified sectors back
-    for (i = firstSector; i <= lastSector; i++)	
-        kernel->synchDisk->WriteSector(hdr->ByteToSector(i * SectorSize), 
-					&buf[(i - firstSector) * SectorSize]);
-    delete [] buf;
+// read in first and last sector, if they are to be partially modified,
+// and copy in the bytes we want to change
+    if (!firstAligned) {
+	bzero(head, SectorSize);	// in case the read stops at EOF
+        ReadAt(head, SectorSize, firstSector * SectorSize);	
+	bcopy(from, &head[position % SectorSize],
+		min(numBytes, SectorSize - position % SectorSize));
+    }
+    if (!lastAligned && ((firstSector != lastSector) || firstAligned)) {
+	bzero(tail, SectorSize);
+        ReadAt(tail, SectorSize, tailStart);	
+	bcopy(&from[tailStart - position], tail,
+					position + numBytes - tailStart);
+    }
+
+// write modified sectors back, the full ones straight from "from"
+    for (i = firstSector; i <= lastSector; i += runLength) {
+	runLength = NextRun(i, min(lastSector, i + TransferSectors - 1));
+	PlaceSectors(i, runLength, buffers, from, position, numBytes,
+							head, tail);
+        kernel->synchDisk->WriteSectors(hdr->ByteToSector(i * SectorSize), 
+			runLength, buffers);
+    }
     return numBytes;
 }
 
+//----------------------------------------------------------------------
+// OpenFile::PlaceSectors
+// 	Fill in "buffers" with where each of "count" sectors of the file,
+//	from sector "first" on, is to be read into or written from, for
+//	a request of "numBytes" bytes at "position".  A sector wholly
+//	inside the request goes straight to/from its part of "data"; a
+//	sector that starts before the request uses "head", and one that
+//	runs past its end uses "tail".
+//----------------------------------------------------------------------
+
+void
+OpenFile::PlaceSectors(int first, int count, char **buffers, char *data,
+			int position, int numBytes, char *head, char *tail)
+{
+    int start;
+
+    for (int i = 0; i < count; i++) {
+	start = (first + i) * SectorSize;
+	if (start < position)
+	    buffers[i] = head;
+	else if (start + SectorSize > position + numBytes)
+	    buffers[i] = tail;
+	else
+	    buffers[i] = &data[start - position];
+    }
+}
+
+//----------------------------------------------------------------------
+// OpenFile::NextRun
+// 	Return how many of the file's sectors, starting with sector
+//	"first" of the file and going no further than sector "last", are
+//	laid out one after another on disk.
+//----------------------------------------------------------------------
+
+int
+OpenFile::NextRun(int first, int last)
+{
+    int sector = hdr->ByteToSector(first * SectorSize);
+    int count = 1;
+
+    while (first + count <= last &&
+	    hdr->ByteToSector((first + count) * SectorSize) == sector + count)
+	count++;
+    return count;
+}
+
+//----------------------------------------------------------------------
+// OpenFile::ReadAhead
+// 	Ask for the next ReadAheadSectors sectors of the file, starting
+//	with sector "first" of the file, to be brought into the disk
+//	cache, without waiting for them.  Sectors already asked for are
+//	not asked for again, and nothing is done until at least half of
+//	those are used up, so that the read-ahead goes to the disk in
+//	runs of several sectors.
+//----------------------------------------------------------------------
+
+void
+OpenFile::ReadAhead(int first)
+{
+    int last = divRoundUp(hdr->FileLength(), SectorSize) - 1;
+    int i, runLength;
+
+    if (readAheadEnd < first)
+	readAheadEnd = first;
+    if (readAheadEnd - first >= ReadAheadSectors / 2)
+	return;				// enough already on the way
+    if (last > first + ReadAheadSectors - 1)
+	last = first + ReadAheadSectors - 1;
+    for (i = readAheadEnd; i <= last; i += runLength) {
+	runLength = NextRun(i, last);
+	kernel->synchDisk->ReadAhead(hdr->ByteToSector(i * SectorSize),
+								runLength);
+    }
+    if (readAheadEnd <= last)
+	readAheadEnd = last + 1;
+}
+
 //----------------------------------------------------------------------
 // OpenFile::Length
 // 	Return the number of bytes in the file.
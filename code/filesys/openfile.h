@@ -60,6 +60,11 @@ class OpenFile {
 };
 
 #else // FILESYS
+#define ReadAheadSectors 16		// How far ahead of a sequential
+					// reader to read the file
+#define TransferSectors	32		// Most sectors read/written with
+					// one request
+
 class FileHeader;
 
 class OpenFile {
@@ -89,7 +94,21 @@ class OpenFile {
     
   private:
     FileHeader *hdr;			// Header for this file 
+    int hdrSector;			// Disk sector holding "hdr"
     int seekPosition;			// Current position within the file
+    int nextReadPosition;		// Where the next read starts, if
+					// the file is being read sequentially
+    int readAheadEnd;			// File sector after the last one
+					// that has been read ahead
+
+    int NextRun(int first, int last);	// How many sectors from "first" on
+					// are contiguous on disk?
+    void PlaceSectors(int first, int count, char **buffers, char *data,
+			int position, int numBytes, char *head, char *tail);
+					// Where does each sector of a
+					// transfer go to/come from?
+    void ReadAhead(int first);		// Start reading the sectors from
+					// "first" on into the cache
 };
 
 #endif // FILESYS
@@ -7,7 +7,10 @@
 // of liability and disclaimer of warranty provisions.
 
 #include "copyright.h"
+#include "debug.h"
 #include "pbitmap.h"
+#include "journal.h"
+#include "disk.h"
 
 //----------------------------------------------------------------------
 // PersistentBitmap::PersistentBitmap(int)
@@ -21,6 +24,10 @@
 
 PersistentBitmap::PersistentBitmap(int numItems):Bitmap(numItems) 
 { 
+    diskMap = new unsigned int[numWords];
+    onDisk = FALSE;
+    changes = new List<int>;
+    journal = NULL;
 }
 
 //----------------------------------------------------------------------
@@ -40,7 +47,10 @@ PersistentBitmap::PersistentBitmap(OpenFile *file, int numItems):Bitmap(numItems
     // map has already been initialized by the BitMap constructor,
     // but we will just overwrite that with the contents of the
     // map found in the file
-    file->ReadAt((char *)map, numWords * sizeof(unsigned), 0);
+    diskMap = new unsigned int[numWords];
+    changes = new List<int>;
+    journal = NULL;
+    FetchFrom(file);
 }
 
 //----------------------------------------------------------------------
@@ -50,6 +60,8 @@ PersistentBitmap::PersistentBitmap(OpenFile *file, int numItems):Bitmap(numItems
 
 PersistentBitmap::~PersistentBitmap()
 { 
+    delete [] diskMap;
+    delete changes;
 }
 
 //----------------------------------------------------------------------
@@ -63,11 +75,23 @@ void
 PersistentBitmap::FetchFrom(OpenFile *file) 
 {
     file->ReadAt((char *)map, numWords * sizeof(unsigned), 0);
+    memcpy(diskMap, map, numWords * sizeof(unsigned));
+    onDisk = TRUE;
+    Recount();
+    while (!changes->IsEmpty())
+	changes->RemoveFront();
 }
 
 //----------------------------------------------------------------------
 // PersistentBitmap::WriteBack
 // 	Store the contents of a persistent bitmap to a Nachos file.
+//	Only the sectors of the file that have changed since the bitmap
+//	was last read or written are written; the first time, all of
+//	them are.
+//
+//	The sectors freed since then are revoked in the journal, so
+//	that no old image of one is replayed over what it holds next.
+//	Like the write itself, this is part of the caller's transaction.
 //
 //	"file" is the place to write the bitmap to
 //----------------------------------------------------------------------
@@ -75,5 +99,71 @@ PersistentBitmap::FetchFrom(OpenFile *file)
 void
 PersistentBitmap::WriteBack(OpenFile *file)
 {
-   file->WriteAt((char *)map, numWords * sizeof(unsigned), 0);
+    int numBytes = numWords * sizeof(unsigned);
+    char *current = (char *)map;
+    char *old = (char *)diskMap;
+    int length;
+    ListIterator<int> iter(changes);
+
+    for (; journal != NULL && !iter.IsDone(); iter.Next())
+	if (iter.Item() < 0 && !Test(-iter.Item() - 1))
+	    journal->Revoke(-iter.Item() - 1);
+
+    for (int i = 0; i < numBytes; i += SectorSize) {
+	length = min(SectorSize, numBytes - i);
+	if (!onDisk || memcmp(&current[i], &old[i], length))
+	    file->WriteAt(&current[i], length, i);
+    }
+    memcpy(diskMap, map, numBytes);
+    onDisk = TRUE;
+    while (!changes->IsEmpty())
+	changes->RemoveFront();
+}
+
+//----------------------------------------------------------------------
+// PersistentBitmap::Revert
+// 	Undo every change made to the bitmap since it was last read from
+//	or written to disk, latest first.  Used when an operation that
+//	has allocated or freed sectors fails part way through.
+//
+//	Only the bits that were actually set or cleared are put back;
+//	the rest of the map is left alone, so that a bit some other
+//	operation has changed in the meantime is not undone with ours.
+//----------------------------------------------------------------------
+
+void
+PersistentBitmap::Revert()
+{
+    while (!changes->IsEmpty()) {
+	int which = changes->RemoveFront();
+
+	if (which >= 0)
+	    Bitmap::Clear(which);
+	else
+	    Bitmap::Mark(-which - 1);
+    }
+}
+
+//----------------------------------------------------------------------
+// PersistentBitmap::Mark, PersistentBitmap::Clear
+// 	Set or clear the "nth" bit, and if that changes it, note the
+//	change for Revert.
+//
+//	"which" is the number of the bit
+//----------------------------------------------------------------------
+
+void
+PersistentBitmap::Mark(int which)
+{
+    if (!Test(which))
+	changes->Prepend(which);
+    Bitmap::Mark(which);
+}
+
+void
+PersistentBitmap::Clear(int which)
+{
+    if (Test(which))
+	changes->Prepend(-which - 1);
+    Bitmap::Clear(which);
 }
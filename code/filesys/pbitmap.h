@@ -16,10 +16,20 @@
 #include "copyright.h"
 #include "bitmap.h"
 #include "openfile.h"
+#include "list.h"
+
+class Journal;
 
 // The following class defines a persistent bitmap.  It inherits all
 // the behavior of a bitmap (see bitmap.h), adding the ability to
 // be read from and stored to the disk.
+//
+// A copy of what is on disk is kept alongside the bitmap, so that
+// WriteBack only writes the sectors of the bitmap that have changed.
+// Every bit that is set or cleared is also noted, until the next
+// WriteBack, so that Revert can undo exactly those changes and no
+// others.  Once the bitmap has a journal, WriteBack also tells it of
+// each sector that was freed (see journal.h).
 
 class PersistentBitmap : public Bitmap {
   public:
@@ -29,7 +39,26 @@ class PersistentBitmap : public Bitmap {
     ~PersistentBitmap(); 			// deallocate bitmap
 
     void FetchFrom(OpenFile *file);     // read bitmap from the disk
-    void WriteBack(OpenFile *file); 	// write bitmap contents to disk 
+    void WriteBack(OpenFile *file); 	// write changed parts of bitmap
+					// contents to disk 
+    void Revert();			// undo changes since the last
+					// FetchFrom/WriteBack
+
+    void Mark(int which);		// Set/clear the "nth" bit, noting
+    void Clear(int which);		// the change so it can be undone
+
+    void SetJournal(Journal *j) { journal = j; }
+					// Tell "j" of the sectors freed
+
+  private:
+    unsigned int *diskMap;		// the bitmap as it is on disk
+    bool onDisk;			// does "diskMap" hold anything yet?
+    List<int> *changes;			// bits changed since the last
+					// FetchFrom/WriteBack, latest first;
+					// bit n is n if it was set, -n-1 if
+					// it was cleared
+    Journal *journal;			// Told of freed sectors, NULL if
+					// none
 };
 
 #endif // PBITMAP_H
@@ -5,10 +5,25 @@
 //	the disk providing a synchronous interface (requests wait until
 //	the request completes).
 //
-//	Use a semaphore to synchronize the interrupt handlers with the
-//	pending requests.  And, because the physical disk can only
-//	handle one operation at a time, use a lock to enforce mutual
-//	exclusion.
+//	Each request gets a semaphore, to synchronize the interrupt
+//	handler with the thread waiting for the request.  Because the
+//	physical disk can only handle one operation at a time, requests
+//	are queued, and the interrupt handler starts the next one as
+//	soon as the disk is done with the current one.  The queue is
+//	shared with the interrupt handler, so it is protected by
+//	disabling interrupts.
+//
+//	Reads are first looked up in a cache of recently used sectors;
+//	only a miss goes to the disk.  A lock protects the cache; it is
+//	not held while waiting for the disk, so that other threads can
+//	use the cache (and queue their own requests) in the meantime.
+//	In write-back mode, writes stay in the cache until the entry is
+//	replaced or the cache is flushed.
+//
+//	Sectors that are about to be read can be read ahead, by a
+//	separate kernel thread, so that a thread reading a file
+//	sequentially finds the next sectors already cached (or on their
+//	way), rather than waiting for a fresh seek and rotation each time.
 //
 // Copyright (c) 1992-1993 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation 
@@ -16,19 +31,70 @@
 
 #include "copyright.h"
 #include "synchdisk.h"
+#include "journal.h"
+#include "main.h"
+
+//----------------------------------------------------------------------
+// DiskRequest::DiskRequest
+// 	Initialize a request to read or write a run of disk sectors.
+//
+//	"sector" -- the first disk sector to read or write
+//	"count" -- the number of consecutive sectors
+//	"buffers" -- for each sector, where to put the data read, or
+//		where to get the data to write
+//	"isWrite" -- is this a write request?
+//----------------------------------------------------------------------
 
+DiskRequest::DiskRequest(int sector, int count, char **buffers, bool isWrite)
+{
+    sectorNumber = sector;
+    numSectors = count;
+    data = new char *[count];
+    for (int i = 0; i < count; i++)
+	data[i] = buffers[i];
+    writing = isWrite;
+    done = new Semaphore("disk request", 0);
+}
+
+DiskRequest::~DiskRequest()
+{
+    delete [] data;
+    delete done;
+}
 
 //----------------------------------------------------------------------
 // SynchDisk::SynchDisk
 // 	Initialize the synchronous interface to the physical disk, in turn
 //	initializing the physical disk.
 //
+//	"doWriteBack" -- if true, hold written sectors in the cache
+//		instead of writing them to disk right away
+//	"policyName" -- the order in which to service queued requests:
+//		"fcfs", "sstf" or "clook"; NULL means C-LOOK
 //----------------------------------------------------------------------
 
-SynchDisk::SynchDisk()
+SynchDisk::SynchDisk(bool doWriteBack, char *policyName)
 {
-    semaphore = new Semaphore("synch disk", 0);
+    writeBack = doWriteBack;
+    if (policyName == NULL || strcmp(policyName, "clook") == 0) {
+	policy = DiskCLOOK;
+    } else if (strcmp(policyName, "sstf") == 0) {
+	policy = DiskSSTF;
+    } else {
+	ASSERT(strcmp(policyName, "fcfs") == 0);
+	policy = DiskFCFS;
+    }
+    queue = new List<DiskRequest *>;
+    active = NULL;
+    headSector = 0;
     lock = new Lock("synch disk lock");
+    transferDone = new Condition("synch disk transfer");
+    cache = new SectorCache(CacheSize);
+    readAheads = new List<ReadAheadRun *>;
+    readAheadReady = new Semaphore("read ahead", 0);
+    flushPending = FALSE;
+    flushNeeded = new Semaphore("flush needed", 0);
+    journal = NULL;
     disk = new Disk(this);
 }
 
@@ -41,8 +107,15 @@ SynchDisk::SynchDisk()
 SynchDisk::~SynchDisk()
 {
     delete disk;
+    while (!readAheads->IsEmpty())
+	delete readAheads->RemoveFront();
+    delete readAheads;
+    delete readAheadReady;
+    delete flushNeeded;
+    delete cache;
+    delete transferDone;
     delete lock;
-    delete semaphore;
+    delete queue;
 }
 
 //----------------------------------------------------------------------
@@ -50,6 +123,9 @@ SynchDisk::~SynchDisk()
 // 	Read the contents of a disk sector into a buffer.  Return only
 //	after the data has been read.
 //
+//	If the sector is in the cache, just copy it out.  Otherwise,
+//	read it from the disk into the least recently used cache entry.
+//
 //	"sectorNumber" -- the disk sector to read
 //	"data" -- the buffer to hold the contents of the disk sector
 //----------------------------------------------------------------------
@@ -57,10 +133,7 @@ SynchDisk::~SynchDisk()
 void
 SynchDisk::ReadSector(int sectorNumber, char* data)
 {
-    lock->Acquire();			// only one disk I/O at a time
-    disk->ReadRequest(sectorNumber, data);
-    semaphore->P();			// wait for interrupt
-    lock->Release();
+    ReadSectors(sectorNumber, 1, &data);
 }
 
 //----------------------------------------------------------------------
@@ -68,6 +141,10 @@ SynchDisk::ReadSector(int sectorNumber, char* data)
 // 	Write the contents of a buffer into a disk sector.  Return only
 //	after the data has been written.
 //
+//	The cached copy of the sector is updated as well, so that the
+//	next read of it is a hit.  In write-back mode, that is all we
+//	do; the sector is marked dirty, and written to disk later.
+//
 //	"sectorNumber" -- the disk sector to be written
 //	"data" -- the new contents of the disk sector
 //----------------------------------------------------------------------
@@ -75,20 +152,594 @@ SynchDisk::ReadSector(int sectorNumber, char* data)
 void
 SynchDisk::WriteSector(int sectorNumber, char* data)
 {
-    lock->Acquire();			// only one disk I/O at a time
-    disk->WriteRequest(sectorNumber, data);
-    semaphore->P();			// wait for interrupt
+    WriteSectors(sectorNumber, 1, &data);
+}
+
+//----------------------------------------------------------------------
+// SectorBuffers
+// 	Return an array pointing to where each of "numSectors" sectors
+//	goes in the contiguous buffer "data".  The caller must delete it.
+//----------------------------------------------------------------------
+
+static char **
+SectorBuffers(char *data, int numSectors)
+{
+    char **buffers = new char *[numSectors];
+
+    for (int i = 0; i < numSectors; i++)
+	buffers[i] = &data[i * SectorSize];
+    return buffers;
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::ReadSectors
+// 	Read "numSectors" consecutive disk sectors into a buffer, or into
+//	a buffer per sector.  Return only after all of the data has been
+//	read.
+//
+//	Cached sectors are copied out of the cache.  Each run of sectors
+//	that are not cached is read from the disk with a single request.
+//
+//	"sectorNumber" -- the first disk sector to read
+//	"numSectors" -- how many sectors to read
+//	"data" -- the buffer to hold the contents of the disk sectors
+//	"buffers" -- for each sector, the buffer to hold its contents
+//----------------------------------------------------------------------
+
+void
+SynchDisk::ReadSectors(int sectorNumber, int numSectors, char* data)
+{
+    char **buffers = SectorBuffers(data, numSectors);
+
+    ReadSectors(sectorNumber, numSectors, buffers);
+    delete [] buffers;
+}
+
+void
+SynchDisk::ReadSectors(int sectorNumber, int numSectors, char** buffers)
+{
+    CacheEntry **run = new CacheEntry *[numSectors];
+    int count;
+
+    lock->Acquire();
+    for (int i = 0; i < numSectors; i += count) {
+	int sector = sectorNumber + i;
+
+	if (cache->Find(sector) != NULL ||
+		(count = GrabRun(sector, numSectors - i, TRUE, run)) == 0) {
+	    CacheEntry *entry = Lookup(sector, TRUE);	// may wait
+
+	    bcopy(entry->data, buffers[i], SectorSize);
+	    cache->Touch(entry);
+	    count = 1;
+	    continue;
+	}
+	kernel->stats->numCacheMisses += count;
+	Transfer(run, count, FALSE);
+	for (int j = 0; j < count; j++) {
+	    bcopy(run[j]->data, buffers[i + j], SectorSize);
+	    cache->Touch(run[j]);
+	}
+    }
+    lock->Release();
+    delete [] run;
+
+    if (journal != NULL)
+	journal->Overlay(sectorNumber, numSectors, buffers);
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::WriteSectors
+// 	Write "numSectors" consecutive disk sectors from a buffer, or
+//	from a buffer per sector.  Return only after all of the data has
+//	been written (or, in write-back mode, copied into the cache).
+//
+//	Write-through writes go to the disk as a few multi-sector
+//	requests, rather than one request per sector.
+//
+//	If the writing thread is in a journal transaction, the sectors
+//	are handed to the journal instead.
+//
+//	"sectorNumber" -- the first disk sector to write
+//	"numSectors" -- how many sectors to write
+//	"data" -- the new contents of the disk sectors
+//	"buffers" -- for each sector, the buffer holding its new contents
+//	"deferWrite" -- hold the sectors in the cache, rather than
+//		writing them through (defaults to the write-back mode)
+//----------------------------------------------------------------------
+
+void
+SynchDisk::WriteSectors(int sectorNumber, int numSectors, char* data)
+{
+    char **buffers = SectorBuffers(data, numSectors);
+
+    WriteSectors(sectorNumber, numSectors, buffers);
+    delete [] buffers;
+}
+
+void
+SynchDisk::WriteSectors(int sectorNumber, int numSectors, char** buffers)
+{
+    if (journal != NULL && journal->Log(sectorNumber, numSectors, buffers))
+	return;
+    WriteSectors(sectorNumber, numSectors, buffers, writeBack);
+}
+
+void
+SynchDisk::WriteSectors(int sectorNumber, int numSectors, char* data,
+							bool deferWrite)
+{
+    char **buffers = SectorBuffers(data, numSectors);
+
+    WriteSectors(sectorNumber, numSectors, buffers, deferWrite);
+    delete [] buffers;
+}
+
+void
+SynchDisk::WriteSectors(int sectorNumber, int numSectors, char** buffers,
+							bool deferWrite)
+{
+    CacheEntry **run = new CacheEntry *[numSectors];
+    int count;
+
+    lock->Acquire();
+    for (int i = 0; i < numSectors; i += count) {
+	int sector = sectorNumber + i;
+
+	count = GrabRun(sector, numSectors - i, FALSE, run);
+	if (count == 0) {
+	    run[0] = Lookup(sector, FALSE);		// may wait
+	    run[0]->busy = TRUE;
+	    count = 1;
+	}
+	for (int j = 0; j < count; j++) {
+	    bcopy(buffers[i + j], run[j]->data, SectorSize);
+	    cache->Touch(run[j]);
+	}
+	if (deferWrite) {
+	    for (int j = 0; j < count; j++) {
+		run[j]->busy = FALSE;
+		run[j]->dirty = TRUE;
+	    }
+	    WakeFlusher();
+	    transferDone->Broadcast(lock);
+	} else {
+	    Transfer(run, count, TRUE);
+	}
+    }
     lock->Release();
+    delete [] run;
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::Flush
+// 	Write every dirty sector in the cache back to the disk.  Return
+//	only after all of them have been written.
+//
+//	All of the writes are queued at once, so that the disk scheduler
+//	can order them.  They are also queued in increasing sector order,
+//	so that even first-come first-served keeps the head moving in one
+//	direction, and dirty sectors that are next to each other on disk
+//	are written with a single request.
+//----------------------------------------------------------------------
+
+void
+SynchDisk::Flush()
+{
+    int numEntries = cache->NumEntries();
+    CacheEntry **dirty = new CacheEntry *[numEntries];
+    char **buffers = new char *[numEntries];
+    DiskRequest **requests = new DiskRequest *[numEntries];
+    int numDirty, numRequests;
+    bool waited;
+
+    lock->Acquire();
+    do {			// wait out any write-back already under way
+	waited = FALSE;
+	numDirty = 0;
+	for (int i = 0; i < numEntries && !waited; i++) {
+	    CacheEntry *entry = cache->Entry(i);
+	    int j;
+
+	    if (!entry->dirty)
+		continue;
+	    if (entry->busy) {
+		transferDone->Wait(lock);
+		waited = TRUE;
+		continue;
+	    }
+	    for (j = numDirty; j > 0 && dirty[j - 1]->sector > entry->sector;
+									j--)
+		dirty[j] = dirty[j - 1];
+	    dirty[j] = entry;
+	    numDirty++;
+	}
+    } while (waited);
+    for (int i = 0; i < numDirty; i++)
+	dirty[i]->busy = TRUE;
+    lock->Release();
+
+    DEBUG(dbgDisk, "Flushing " << numDirty << " dirty sectors");
+    numRequests = 0;
+    for (int i = 0, count; i < numDirty; i += count) {
+	buffers[0] = dirty[i]->data;
+	for (count = 1; i + count < numDirty &&
+		dirty[i + count]->sector == dirty[i]->sector + count; count++)
+	    buffers[count] = dirty[i + count]->data;
+	requests[numRequests] = new DiskRequest(dirty[i]->sector, count,
+							buffers, TRUE);
+	Submit(requests[numRequests++]);
+    }
+    for (int i = 0; i < numRequests; i++) {
+	requests[i]->done->P();
+	delete requests[i];
+    }
+
+    lock->Acquire();
+    for (int i = 0; i < numDirty; i++)
+	dirty[i]->busy = dirty[i]->dirty = FALSE;
+    transferDone->Broadcast(lock);
+    lock->Release();
+    disk->Sync();
+
+    delete [] requests;
+    delete [] buffers;
+    delete [] dirty;
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::FlushLater
+// 	Make sure the flush daemon runs within FlushInterval ticks.
+//	Used by the journal, which in write-back mode leaves ended
+//	transactions for the daemon to commit.
+//----------------------------------------------------------------------
+
+void
+SynchDisk::FlushLater()
+{
+    lock->Acquire();
+    WakeFlusher();
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::WakeFlusher
+// 	Wake the flush daemon, unless it has already been told that
+//	there is work.  The caller must hold "lock".
+//----------------------------------------------------------------------
+
+void
+SynchDisk::WakeFlusher()
+{
+    if (!flushPending) {
+	flushPending = TRUE;
+	flushNeeded->V();
+    }
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::FlushDaemon
+// 	Body of the flush daemon, run only in write-back mode.  Sleep
+//	until some sector is left dirty in the cache, or the journal has
+//	transactions to commit, give it (and any others that follow)
+//	FlushInterval ticks to be written again, then commit the
+//	transactions and write everything back.
+//
+//	The daemon sleeps on a semaphore, not on the alarm, while the
+//	cache is clean, so it does not keep Nachos from halting.
+//----------------------------------------------------------------------
+
+void
+SynchDisk::FlushDaemon()
+{
+    for (;;) {
+	flushNeeded->P();
+	kernel->alarm->WaitUntil(FlushInterval);
+	lock->Acquire();
+	flushPending = FALSE;		// what comes after needs another round
+	lock->Release();
+	if (journal != NULL)
+	    journal->Commit();		// hands its sectors to the cache
+	Flush();
+    }
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::ReadAhead
+// 	Ask the read-ahead daemon to bring a run of sectors into the
+//	cache, and return right away.  Read-ahead is only a hint: if too
+//	many runs are already waiting, this one is dropped.
+//
+//	"sectorNumber" -- the first disk sector to read
+//	"numSectors" -- how many sectors to read
+//----------------------------------------------------------------------
+
+void
+SynchDisk::ReadAhead(int sectorNumber, int numSectors)
+{
+    lock->Acquire();
+    if (readAheads->NumInList() < MaxReadAheads) {
+	readAheads->Append(new ReadAheadRun(sectorNumber, numSectors));
+	readAheadReady->V();
+    }
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::ReadAheadDaemon
+// 	Body of the read-ahead daemon.  Wait for a run to be queued by
+//	ReadAhead, then read the sectors of it that are not already
+//	cached, in as few requests as possible.  If the cache has no
+//	clean entry to spare, give up on the rest of the run rather than
+//	writing back dirty sectors to make room.
+//----------------------------------------------------------------------
+
+void
+SynchDisk::ReadAheadDaemon()
+{
+    for (;;) {
+	ReadAheadRun *next;
+	CacheEntry **run;
+	int count;
+
+	readAheadReady->P();
+	lock->Acquire();
+	next = readAheads->RemoveFront();
+	run = new CacheEntry *[next->numSectors];
+	for (int i = 0; i < next->numSectors; i += count) {
+	    int sector = next->sectorNumber + i;
+
+	    if (cache->Find(sector) != NULL) {
+		count = 1;
+		continue;
+	    }
+	    count = GrabRun(sector, next->numSectors - i, TRUE, run);
+	    if (count == 0)
+		break;
+	    DEBUG(dbgDisk, "Reading ahead " << count << " sectors at " << sector);
+	    kernel->stats->numReadAheads += count;
+	    Transfer(run, count, FALSE);
+	}
+	lock->Release();
+	delete [] run;
+	delete next;
+    }
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::Lookup
+// 	Return a cache entry holding "sectorNumber" that is not busy.
+//	If the sector isn't cached, make room for it, writing back the
+//	least recently used entry first if it is dirty.  The caller must
+//	hold the lock.
+//
+//	"sectorNumber" -- the disk sector to look up
+//	"fill" -- if the sector has to be brought into the cache, read
+//		its contents from the disk?  (Not needed if the caller is
+//		about to overwrite the whole sector.)
+//----------------------------------------------------------------------
+
+CacheEntry *
+SynchDisk::Lookup(int sectorNumber, bool fill)
+{
+    CacheEntry *entry;
+
+    for (;;) {
+	entry = cache->Find(sectorNumber);
+	if (entry != NULL) {
+	    if (!entry->busy) {
+		if (fill)
+		    kernel->stats->numCacheHits++;
+		return entry;
+	    }
+	    transferDone->Wait(lock);	// someone else is moving it
+	    continue;
+	}
+
+	entry = cache->Victim();
+	if (entry == NULL) {
+	    transferDone->Wait(lock);	// every entry is busy
+	    continue;
+	}
+	if (entry->dirty) {
+	    Transfer(&entry, 1, TRUE);
+	    continue;			// look again; things may have
+					// changed while we were waiting
+	}
+
+	entry = cache->Replace(sectorNumber);
+	if (fill) {
+	    kernel->stats->numCacheMisses++;
+	    Transfer(&entry, 1, FALSE);
+	}
+	return entry;
+    }
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::GrabRun
+// 	Collect cache entries for as many consecutive sectors, starting
+//	at sectorNumber, as we can without waiting: sectors that are
+//	cached and not busy, or that can be given a clean entry that is
+//	not busy.  The entries are marked busy, so that they stay put
+//	until the caller is done with them.  The caller must hold the
+//	lock.  Returns the number of entries collected, possibly 0.
+//
+//	"sectorNumber" -- the first sector of the run
+//	"maxCount" -- the most sectors to collect
+//	"uncachedOnly" -- stop at the first sector that is already cached
+//		(a reader only wants the sectors it has to fetch)
+//	"run" -- where to put the entries
+//----------------------------------------------------------------------
+
+int
+SynchDisk::GrabRun(int sectorNumber, int maxCount, bool uncachedOnly,
+						CacheEntry **run)
+{
+    int count;
+
+    for (count = 0; count < maxCount; count++) {
+	int sector = sectorNumber + count;
+	CacheEntry *entry = cache->Find(sector);
+
+	if (entry != NULL) {
+	    if (entry->busy || uncachedOnly)
+		break;
+	} else {
+	    CacheEntry *victim = cache->Victim();
+
+	    if (victim == NULL || victim->dirty)
+		break;
+	    entry = cache->Replace(sector);
+	}
+	entry->busy = TRUE;
+	run[count] = entry;
+    }
+    return count;
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::Transfer
+// 	Read a run of cache entries, holding consecutive sectors, from
+//	the disk, or write them to it, with a single request.  The
+//	entries are marked busy, and the lock released, while we wait for
+//	the disk.  The caller must hold the lock.
+//
+//	"entries" -- the cache entries to transfer
+//	"count" -- how many entries
+//	"writing" -- write the entries to disk, rather than reading them?
+//----------------------------------------------------------------------
+
+void
+SynchDisk::Transfer(CacheEntry **entries, int count, bool writing)
+{
+    char **buffers = new char *[count];
+    DiskRequest *request;
+
+    for (int i = 0; i < count; i++) {
+	ASSERT(entries[i]->sector == entries[0]->sector + i);
+	entries[i]->busy = TRUE;
+	buffers[i] = entries[i]->data;
+    }
+    request = new DiskRequest(entries[0]->sector, count, buffers, writing);
+    lock->Release();
+    Submit(request);
+    request->done->P();			// wait for interrupt
+    lock->Acquire();
+    for (int i = 0; i < count; i++) {
+	entries[i]->busy = FALSE;
+	if (writing)
+	    entries[i]->dirty = FALSE;
+    }
+    transferDone->Broadcast(lock);
+    delete request;
+    delete [] buffers;
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::Submit
+// 	Put a request on the disk queue, starting the disk if it is idle.
+//	Returns right away; the caller waits on request->done.
+//----------------------------------------------------------------------
+
+void
+SynchDisk::Submit(DiskRequest *request)
+{
+    IntStatus oldLevel = kernel->interrupt->SetLevel(IntOff);
+
+    queue->Append(request);
+    if (active == NULL)
+	StartNext();
+    (void) kernel->interrupt->SetLevel(oldLevel);
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::StartNext
+// 	Take the next request off the queue, and send it to the disk.
+//	Called with interrupts disabled, when the disk is idle.
+//----------------------------------------------------------------------
+
+void
+SynchDisk::StartNext()
+{
+    DiskRequest *request = NextRequest();
+    int seek = request->sectorNumber / SectorsPerTrack -
+				headSector / SectorsPerTrack;
+
+    queue->Remove(request);
+    active = request;
+    kernel->stats->numDiskSeekTracks += (seek < 0) ? -seek : seek;
+    headSector = request->sectorNumber + request->numSectors - 1;
+    if (request->writing)
+	disk->WriteRequest(request->sectorNumber, request->numSectors,
+							request->data);
+    else
+	disk->ReadRequest(request->sectorNumber, request->numSectors,
+							request->data);
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::NextRequest
+// 	Choose which queued request should go to the disk next, according
+//	to the scheduling policy.  The queue must not be empty.
+//----------------------------------------------------------------------
+
+DiskRequest *
+SynchDisk::NextRequest()
+{
+    ListIterator<DiskRequest *> iter(queue);
+    DiskRequest *best = NULL;
+    DiskRequest *lowest = NULL;
+    int headTrack = headSector / SectorsPerTrack;
+
+    ASSERT(!queue->IsEmpty());
+    if (policy == DiskFCFS)
+	return queue->Front();
+
+    for (; !iter.IsDone(); iter.Next()) {
+	DiskRequest *request = iter.Item();
+	int sector = request->sectorNumber;
+
+	if (policy == DiskSSTF) {
+	    int distance = sector / SectorsPerTrack - headTrack;
+	    int bestDistance;
+
+	    if (best == NULL) {
+		best = request;
+		continue;
+	    }
+	    bestDistance = best->sectorNumber / SectorsPerTrack - headTrack;
+	    if (distance < 0)
+		distance = -distance;
+	    if (bestDistance < 0)
+		bestDistance = -bestDistance;
+	    if (distance < bestDistance)
+		best = request;
+	} else {		// DiskCLOOK
+	    if (lowest == NULL || sector < lowest->sectorNumber)
+		lowest = request;
+	    if (sector >= headSector &&
+			(best == NULL || sector < best->sectorNumber))
+		best = request;
+	}
+    }
+    return (best != NULL) ? best : lowest;
 }
 
 //----------------------------------------------------------------------
 // SynchDisk::CallBack
-// 	Disk interrupt handler.  Wake up any thread waiting for the disk
-//	request to finish.
+// 	Disk interrupt handler.  Start the next queued request, if any,
+//	and wake up the thread waiting for the one that just finished.
 //----------------------------------------------------------------------
 
 void
 SynchDisk::CallBack()
 { 
-    semaphore->V();
+    DiskRequest *finished = active;
+
+    ASSERT(finished != NULL);
+    active = NULL;
+    if (!queue->IsEmpty())
+	StartNext();
+    finished->done->V();
 }
@@ -13,7 +13,56 @@
 
 #include "disk.h"
 #include "synch.h"
+#include "list.h"
 #include "callback.h"
+#include "cache.h"
+
+class Journal;
+
+#define FlushInterval	100000	// In write-back mode, how often (in
+				// ticks) the flush daemon writes
+				// dirty sectors to disk
+#define MaxReadAheads	8	// How many read-ahead runs may be
+				// waiting for the read-ahead daemon
+
+// The order in which queued requests are sent to the disk.
+
+enum DiskSchedPolicy {
+    DiskFCFS,		// in order of arrival
+    DiskSSTF,		// the request on the track nearest the head first
+    DiskCLOOK		// sweep toward higher sector numbers, then jump
+			// back to the lowest outstanding request
+};
+
+// The following class defines a single request waiting for, or being
+// serviced by, the disk: a run of one or more consecutive sectors, each
+// with its own buffer.  The requesting thread waits on "done".
+
+class DiskRequest {
+  public:
+    DiskRequest(int sector, int count, char **buffers, bool isWrite);
+    ~DiskRequest();
+
+    int sectorNumber;			// First sector to read or write
+    int numSectors;			// How many sectors in the run
+    char **data;			// Where to read each sector to/write
+					// it from
+    bool writing;			// Is this a write?
+    Semaphore *done;			// Signalled when the request is done
+};
+
+// The following class defines a run of sectors that some thread
+// expects to read soon, and that the read-ahead daemon should bring
+// into the cache.
+
+class ReadAheadRun {
+  public:
+    ReadAheadRun(int sector, int count) {
+	sectorNumber = sector; numSectors = count; }
+
+    int sectorNumber;			// First sector to read
+    int numSectors;			// How many sectors in the run
+};
 
 // The following class defines a "synchronous" disk abstraction.
 // As with other I/O devices, the raw physical disk is an asynchronous device --
@@ -25,20 +74,88 @@
 // This class provides the abstraction that for any individual thread
 // making a request, it waits around until the operation finishes before
 // returning.
+//
+// ReadSectors/WriteSectors handle a run of consecutive sectors, and
+// send the parts of it that must go to the disk as multi-sector
+// requests, rather than one request per sector.  The sectors of a run
+// need not come from (or go to) one contiguous buffer: OpenFile reads
+// and writes whole sectors of a file straight to and from the caller's
+// buffer, with only the partly used sectors at either end going
+// through buffers of its own.
+//
+// Requests from different threads may be outstanding at the same
+// time.  They are kept on a queue, and each time the disk finishes a
+// request, the next one is chosen according to the scheduling policy,
+// to cut down on the time spent seeking.
+//
+// Recently used sectors are kept in a SectorCache, so that a read
+// of a cached sector returns without going to the disk at all.
+// Normally writes go through the cache to the disk immediately.
+// In write-back mode, a write only updates the cache; the dirty
+// sector goes to the disk when it is replaced, or on Flush.  This
+// turns repeated writes of the same sector (the free map, a directory)
+// into one disk write, at the price of losing them if Nachos crashes.
+// The flush daemon (a kernel thread running FlushDaemon) bounds the
+// loss: once a sector is left dirty, or the journal has transactions
+// waiting to be committed, it waits FlushInterval ticks, then commits
+// them and does a Flush.
+//
+// ReadAhead asks for sectors to be brought into the cache without
+// waiting for them.  The run is handed to a kernel thread (the
+// read-ahead daemon, running ReadAheadDaemon), which reads it while
+// the thread that asked goes on with its work.
+//
+// Once the file system has a metadata journal, every write is first
+// offered to it, and every read is patched by it (see journal.h).
 
 class SynchDisk : public CallBackObj {
   public:
-    SynchDisk();    		        // Initialize a synchronous disk,
+    SynchDisk(bool doWriteBack, char *policyName);
+					// Initialize a synchronous disk,
 					// by initializing the raw Disk.
     ~SynchDisk();			// De-allocate the synch disk data
     
     void ReadSector(int sectorNumber, char* data);
     					// Read/write a disk sector, returning
     					// only once the data is actually read 
-					// or written.  These call
-    					// Disk::ReadRequest/WriteRequest and
-					// then wait until the request is done.
+					// or written.  These queue a request
+					// for the disk and then wait until
+					// the request is done.
     void WriteSector(int sectorNumber, char* data);
+
+    void ReadSectors(int sectorNumber, int numSectors, char* data);
+    void WriteSectors(int sectorNumber, int numSectors, char* data);
+					// Read/write "numSectors" consecutive
+					// sectors, to/from a contiguous buffer
+    void ReadSectors(int sectorNumber, int numSectors, char** buffers);
+    void WriteSectors(int sectorNumber, int numSectors, char** buffers);
+					// Read/write "numSectors" consecutive
+					// sectors, each to/from its own
+					// buffer
+    void WriteSectors(int sectorNumber, int numSectors, char* data,
+							bool deferWrite);
+					// Write, bypassing the journal, and
+					// either holding the sectors dirty in
+					// the cache, or writing them to disk
+					// now, whatever the write-back mode
+
+    void SetJournal(Journal *j) { journal = j; }
+					// Send writes through "j"
+
+    void Flush();			// Write every dirty cached sector
+					// to the disk
+    void FlushLater();			// Have the flush daemon do a Flush
+					// soon
+    bool IsWriteBack() { return writeBack; }
+    void FlushDaemon();			// Body of the thread that flushes
+					// periodically; never returns
+    
+    void ReadAhead(int sectorNumber, int numSectors);
+					// Start reading "numSectors"
+					// consecutive sectors into the
+					// cache, without waiting
+    void ReadAheadDaemon();		// Body of the thread that does the
+					// reading; never returns
     
     void CallBack();			// Called by the disk device interrupt
 					// handler, to signal that the
@@ -46,10 +163,48 @@ class SynchDisk : public CallBackObj {
 
   private:
     Disk *disk;		  		// Raw disk device
-    Semaphore *semaphore; 		// To synchronize requesting thread 
-					// with the interrupt handler
-    Lock *lock;		  		// Only one read/write request
-					// can be sent to the disk at a time
+    DiskSchedPolicy policy;		// How to order queued requests
+    List<DiskRequest *> *queue;		// Requests waiting for the disk
+    DiskRequest *active;		// Request the disk is working on,
+					// NULL if the disk is idle
+    int headSector;			// Sector of the last request sent
+					// to the disk
+
+    Lock *lock;		  		// Protects the cache
+    Condition *transferDone;		// Signalled when a busy cache entry
+					// stops being busy
+    SectorCache *cache;			// Recently used sectors
+    bool writeBack;			// Hold writes in the cache?
+    Journal *journal;			// Metadata journal, NULL if none
+
+    List<ReadAheadRun *> *readAheads;	// Runs waiting to be read ahead;
+					// protected by "lock"
+    Semaphore *readAheadReady;		// Counts the runs in "readAheads"
+
+    bool flushPending;			// Has the flush daemon been told
+					// that there is work?  Protected
+					// by "lock"
+    Semaphore *flushNeeded;		// Signalled when there is work and
+					// "flushPending" was FALSE
+
+    CacheEntry *Lookup(int sectorNumber, bool fill);
+					// Find or make room for a sector
+    int GrabRun(int sectorNumber, int maxCount, bool uncachedOnly,
+					CacheEntry **run);
+					// Find or make room for a run of
+					// sectors, without waiting
+    void Transfer(CacheEntry **entries, int count, bool writing);
+					// Move a run of cache entries to/from
+					// disk
+
+    void WriteSectors(int sectorNumber, int numSectors, char** buffers,
+							bool deferWrite);
+					// Write, bypassing the journal
+
+    void WakeFlusher();			// FlushLater, with "lock" held
+    void Submit(DiskRequest *request);	// Queue a request for the disk
+    void StartNext();			// Send the next request to the disk
+    DiskRequest *NextRequest();		// Which request should go next?
 };
 
 #endif // SYNCHDISK_H
@@ -30,6 +30,8 @@ Bitmap::Bitmap(int numItems)
     for (i = 0; i < numWords; i++) {
 	map[i] = 0;		// initialize map to keep Purify happy
     }
+    numClear = numBits;
+    nextFree = 0;
     for (i = 0; i < numBits; i++) {
         Clear(i);
     }
@@ -57,6 +59,9 @@ Bitmap::Mark(int which)
 { 
     ASSERT(which >= 0 && which < numBits);
 
+    if (!Test(which)) {
+	numClear--;
+    }
     map[which / BitsInWord] |= 1 << (which % BitsInWord);
 
     ASSERT(Test(which));
@@ -74,7 +79,13 @@ Bitmap::Clear(int which)
 {
     ASSERT(which >= 0 && which < numBits);
 
+    if (Test(which)) {
+	numClear++;
+    }
     map[which / BitsInWord] &= ~(1 << (which % BitsInWord));
+    if (which < nextFree) {
+	nextFree = which;
+    }
 
     ASSERT(!Test(which));
 }
@@ -100,25 +111,168 @@ Bitmap::Test(int which) const
 
 //----------------------------------------------------------------------
 // Bitmap::FindAndSet
-// 	Return the number of the first bit which is clear.
+// 	Return the number of the first bit at or after "goal" which is
+//	clear, or if there is none, the first clear bit before "goal".
 //	As a side effect, set the bit (mark it as in use).
 //	(In other words, find and allocate a bit.)
 //
 //	If no bits are clear, return -1.
+//
+//	"goal" is where to start looking (0 for the first clear bit)
 //----------------------------------------------------------------------
 
 int 
-Bitmap::FindAndSet() 
+Bitmap::FindAndSet(int goal) 
 {
-    for (int i = 0; i < numBits; i++) {
-	if (!Test(i)) {
+    int i;
+
+    if (goal > nextFree) {
+	i = NextClear(goal);
+	if (i < numBits) {
 	    Mark(i);
 	    return i;
 	}
     }
+    i = NextClear(nextFree);
+    nextFree = i;
+    if (i == numBits) {
+	return -1;
+    }
+    Mark(i);
+    nextFree = i + 1;
+    return i;
+}
+
+//----------------------------------------------------------------------
+// Bitmap::NextClear, Bitmap::NextSet
+// 	Return the number of the first bit at or after "from" which is
+//	clear (or set).  If there is none, return numBits.
+//
+//	Each word is checked all at once; within the word where the
+//	search stops, the bit is found by counting trailing zeros.
+//	The unused bits at the end of the last word are always clear,
+//	so NextClear may run into them, and must not return them.
+//----------------------------------------------------------------------
+
+int
+Bitmap::NextClear(int from) const
+{
+    int w = from / BitsInWord;
+    unsigned int bits;
+
+    if (from >= numBits) {
+	return numBits;
+    }
+    bits = ~map[w] & (~0U << (from % BitsInWord));
+    while (bits == 0) {
+	if (++w == numWords) {
+	    return numBits;
+	}
+	bits = ~map[w];
+    }
+    return min(w * BitsInWord + __builtin_ctz(bits), numBits);
+}
+
+int
+Bitmap::NextSet(int from) const
+{
+    int w = from / BitsInWord;
+    unsigned int bits;
+
+    if (from >= numBits) {
+	return numBits;
+    }
+    bits = map[w] & (~0U << (from % BitsInWord));
+    while (bits == 0) {
+	if (++w == numWords) {
+	    return numBits;
+	}
+	bits = map[w];
+    }
+    return w * BitsInWord + __builtin_ctz(bits);
+}
+
+//----------------------------------------------------------------------
+// Bitmap::FindContiguous
+// 	Return the number of the first bit of the first run of "count"
+//	consecutive clear bits, or -1 if there is no such run.  Unlike
+//	FindAndSet, the bits are not set.
+//
+//	"count" is the number of clear bits wanted
+//----------------------------------------------------------------------
+
+int
+Bitmap::FindContiguous(int count) const
+{
+    int start, end;
+
+    ASSERT(count > 0);
+
+    if (count > numClear) {
+	return -1;
+    }
+    for (start = NextClear(nextFree); start < numBits;
+					start = NextClear(end)) {
+	end = NextSet(start);
+	if (end - start >= count) {
+	    return start;
+	}
+    }
     return -1;
 }
 
+//----------------------------------------------------------------------
+// Bitmap::FindAndSetRun
+// 	Find a run of consecutive clear bits, set them, and return the
+//	number of the first one.  If there is a run of "count" clear bits,
+//	the first such run is taken; otherwise the longest run there is
+//	(the first one, if there is a tie).  That way, a caller that needs
+//	"count" bits in total can call this repeatedly, and gets as few
+//	runs as the bitmap allows.
+//
+//	The search starts at "goal", and wraps around to the beginning
+//	of the bitmap, so "first" means first in that order.
+//
+//	If no bits are clear, return -1.
+//
+//	"count" is the number of bits wanted
+//	"length" is set to the number of bits in the run that was taken
+//	"goal" is where to start looking (0 for the whole bitmap in order)
+//----------------------------------------------------------------------
+
+int
+Bitmap::FindAndSetRun(int count, int *length, int goal)
+{
+    int bestStart = -1, bestLength = 0;
+    int start, end, limit, i;
+
+    ASSERT(count > 0);
+
+    // first from "goal" to the end, then from the beginning to "goal"
+    start = NextClear(max(goal, nextFree));
+    limit = numBits;
+    for (int pass = 0; pass < 2 && bestLength < count; pass++) {
+	for (; start < limit; start = NextClear(end)) {
+	    end = min(NextSet(start), start + count);
+	    if (end - start > bestLength) {
+		bestStart = start;
+		bestLength = end - start;
+		if (bestLength == count) {
+		    break;		// can't do better than this
+		}
+	    }
+	}
+	start = NextClear(nextFree);
+	limit = goal;
+    }
+
+    for (i = 0; i < bestLength; i++) {
+	Mark(bestStart + i);
+    }
+    *length = bestLength;
+    return bestStart;
+}
+
 //----------------------------------------------------------------------
 // Bitmap::NumClear
 // 	Return the number of clear bits in the bitmap.
@@ -128,14 +282,53 @@ Bitmap::FindAndSet()
 int 
 Bitmap::NumClear() const
 {
-    int count = 0;
+    return numClear;
+}
 
-    for (int i = 0; i < numBits; i++) {
-	if (!Test(i)) {
-	    count++;
+//----------------------------------------------------------------------
+// Bitmap::NumClear
+// 	Return the number of clear bits among the "count" bits starting
+//	with bit "from".  Whole words are counted at once.
+//----------------------------------------------------------------------
+
+int
+Bitmap::NumClear(int from, int count) const
+{
+    int end = min(from + count, numBits);
+    int clear = 0;
+
+    ASSERT(from >= 0 && count >= 0);
+
+    for (int i = from; i < end; ) {
+	if (i % BitsInWord == 0 && i + BitsInWord <= end) {
+	    clear += BitsInWord - __builtin_popcount(map[i / BitsInWord]);
+	    i += BitsInWord;
+	} else {
+	    if (!Test(i)) {
+		clear++;
+	    }
+	    i++;
 	}
     }
-    return count;
+    return clear;
+}
+
+//----------------------------------------------------------------------
+// Bitmap::Recount
+// 	Recompute the count of clear bits, and the hint for where to
+//	start looking for one.  Must be called whenever "map" is changed
+//	other than through Mark and Clear (e.g., when it is read in from
+//	disk).
+//----------------------------------------------------------------------
+
+void
+Bitmap::Recount()
+{
+    numClear = numBits;
+    for (int i = 0; i < numWords; i++) {
+	numClear -= __builtin_popcount(map[i]);
+    }
+    nextFree = 0;
 }
 
 //----------------------------------------------------------------------
@@ -177,14 +370,21 @@ Bitmap::SelfTest()
     ASSERT(Test(0) && Test(31));
 
     ASSERT(FindAndSet() == 1);
+    ASSERT(FindContiguous(29) == 2);
+    ASSERT(FindContiguous(30) == 32);
+    ASSERT(NumClear(0, BitsInWord) == BitsInWord - 3);
+    ASSERT(FindAndSet(30) == 30);
+    Clear(30);
     Clear(0);
     Clear(1);
     Clear(31);
+    ASSERT(NumClear() == numBits);
 
     for (i = 0; i < numBits; i++) {
         Mark(i);
     }
     ASSERT(FindAndSet() == -1);		// bitmap should be full!
+    ASSERT(NumClear() == 0);
     for (i = 0; i < numBits; i++) {
         Clear(i);
     }
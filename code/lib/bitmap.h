@@ -4,6 +4,8 @@
 //
 //	Represented as an array of unsigned integers, on which we do
 //	modulo arithmetic to find the bit we are interested in.
+//	Searches look at a whole word at a time, rather than a bit at
+//	a time, skipping over words that are all set (or all clear).
 //
 //	The bitmap can be parameterized with with the number of bits being 
 //	managed.
@@ -36,13 +38,29 @@ class Bitmap {
 				// initially, all bits are cleared.
     ~Bitmap();			// De-allocate bitmap
     
-    void Mark(int which);   	// Set the "nth" bit
-    void Clear(int which);  	// Clear the "nth" bit
+    virtual void Mark(int which);	// Set the "nth" bit
+    virtual void Clear(int which);	// Clear the "nth" bit
     bool Test(int which) const;	// Is the "nth" bit set?
-    int FindAndSet();         // Return the # of a clear bit, and as a side
-				// effect, set the bit. 
+    int FindAndSet(int goal = 0);
+				// Return the # of a clear bit, and as a side
+				// effect, set the bit.  The first clear bit
+				// at or after "goal" is preferred.
 				// If no bits are clear, return -1.
+    int FindContiguous(int count) const;
+				// Return the # of the first bit of a run
+				// of "count" clear bits, or -1 if there
+				// is no such run.  No bits are set.
+    int FindAndSetRun(int count, int *length, int goal = 0);
+				// Return the # of the first bit of a run
+				// of up to "count" clear bits, and set
+				// them; "*length" is set to the number
+				// of bits in the run.  Runs at or after
+				// "goal" are preferred.  If no bits are
+				// clear, return -1.
     int NumClear() const;	// Return the number of clear bits
+    int NumClear(int from, int count) const;
+				// Return the number of clear bits among
+				// the "count" bits starting at "from"
 
     void Print() const;		// Print contents of bitmap
     void SelfTest();		// Test whether bitmap is working
@@ -54,6 +72,14 @@ class Bitmap {
 				//  multiple of the number of bits in
 				//  a word)
     unsigned int *map;		// bit storage
+    int numClear;		// number of clear bits
+    int nextFree;		// no bit before this one is clear
+
+    void Recount();		// Recompute "numClear" and "nextFree",
+				// after "map" is changed directly
+    int NextClear(int from) const;	// # of the first clear/set bit
+    int NextSet(int from) const;	// at or after "from", or numBits
+				// if there is none
 };
 
 #endif // BITMAP_H
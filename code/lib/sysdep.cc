@@ -32,6 +32,7 @@
 #include <sys/file.h>
 #include <sys/socket.h>
 #include <sys/un.h>
+#include <sys/mman.h>
 #include <cerrno>
 
 #ifdef SOLARIS
@@ -420,6 +421,48 @@ Unlink(char *name)
     return unlink(name);
 }
 
+//----------------------------------------------------------------------
+// MapFile
+// 	Map the first "nBytes" of an open file into memory, shared, so
+//	that stores to the returned memory change the file.  Abort if
+//	the file can't be mapped.
+//----------------------------------------------------------------------
+
+char *
+MapFile(int fd, int nBytes)
+{
+    void *addr = mmap(NULL, nBytes, PROT_READ | PROT_WRITE, MAP_SHARED,
+								fd, 0);
+
+    ASSERT(addr != MAP_FAILED);
+    return (char *) addr;
+}
+
+//----------------------------------------------------------------------
+// SyncMappedFile
+// 	Write any changes made to a mapped file out to the file, returning
+//	only once they are written.
+//----------------------------------------------------------------------
+
+void
+SyncMappedFile(char *addr, int nBytes)
+{
+    int retVal = msync(addr, nBytes, MS_SYNC);
+    ASSERT(retVal >= 0);
+}
+
+//----------------------------------------------------------------------
+// UnmapFile
+// 	Undo MapFile.
+//----------------------------------------------------------------------
+
+void
+UnmapFile(char *addr, int nBytes)
+{
+    int retVal = munmap(addr, nBytes);
+    ASSERT(retVal >= 0);
+}
+
 //----------------------------------------------------------------------
 // OpenSocket
 // 	Open an interprocess communication (IPC) connection.  For now, 
@@ -53,6 +53,12 @@ extern int Tell(int fd);
 extern int Close(int fd);
 extern bool Unlink(char *name);
 
+// Map an open file into memory, so that it can be read and written
+// by copying to/from memory rather than by read/write calls.
+extern char *MapFile(int fd, int nBytes);
+extern void SyncMappedFile(char *addr, int nBytes);
+extern void UnmapFile(char *addr, int nBytes);
+
 // Other C library routines that are used by Nachos.
 // These are assumed to be portable, so we don't include a wrapper.
 extern "C" {
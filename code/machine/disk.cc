@@ -22,24 +22,44 @@
 // We put a magic number at the front of the UNIX file representing the
 // disk, to make it less likely we will accidentally treat a useful file 
 // as a disk (which would probably trash the file's contents).
+//
+// Disks made by older versions of Nachos have only the magic number,
+// and the default geometry.  Newer ones have a different magic number,
+// followed by the number of tracks and the number of sectors per track.
 
 const int MagicNumber = 0x456789ab;
 const int MagicSize = sizeof(int);
-const int DiskSize = (MagicSize + (NumSectors * SectorSize));
+const int GeometryMagicNumber = 0x456789ac;
+const int GeometrySize = 3 * sizeof(int);
+
+int SectorsPerTrack = DefaultSectorsPerTrack;
+int NumTracks = DefaultNumTracks;
+int NumSectors = DefaultSectorsPerTrack * DefaultNumTracks;
 
 
 //----------------------------------------------------------------------
 // Disk::Disk()
 // 	Initialize a simulated disk.  Open the UNIX file (creating it
 //	if it doesn't exist), and check the magic number to make sure it's 
-// 	ok to treat it as Nachos disk storage.
+// 	ok to treat it as Nachos disk storage.  The disk geometry is
+//	taken from the file.
+//
+//	If the -dg flag asks for a different geometry from the one the
+//	file has, the file is thrown away and a new one created.  That
+//	loses everything on the disk, so it is only done when the disk
+//	is about to be formatted (-f); otherwise Nachos refuses to start.
+//
+//	If the -dm flag is given, the whole file is then mapped into
+//	memory.
 //
 //	"toCall" -- object to call when disk read/write request completes
 //----------------------------------------------------------------------
 
 Disk::Disk(CallBackObj *toCall)
 {
-    int magicNum;
+    int header[GeometrySize / sizeof(int)];
+    int tracks = kernel->diskTracks;
+    int perTrack = kernel->diskSectorsPerTrack;
     int tmp = 0;
 
     DEBUG(dbgDisk, "Initializing the disk.");
@@ -50,17 +70,62 @@ Disk::Disk(CallBackObj *toCall)
     sprintf(diskname,"DISK_%d",kernel->hostName);
     fileno = OpenForReadWrite(diskname, FALSE);
     if (fileno >= 0) {		 	// file exists, check magic number 
-	Read(fileno, (char *) &magicNum, MagicSize);
-	ASSERT(magicNum == MagicNumber);
-    } else {				// file doesn't exist, create it
+	Read(fileno, (char *) header, MagicSize);
+	if (header[0] == GeometryMagicNumber) {
+	    Read(fileno, (char *) &header[1], GeometrySize - MagicSize);
+	    headerSize = GeometrySize;
+	} else {
+	    ASSERT(header[0] == MagicNumber);
+	    header[1] = DefaultNumTracks;
+	    header[2] = DefaultSectorsPerTrack;
+	    headerSize = MagicSize;
+	}
+	if (tracks == 0) {
+	    tracks = header[1];
+	    perTrack = header[2];
+	} else if (tracks != header[1] || perTrack != header[2]) {
+#ifndef FILESYS_STUB
+	    if (!kernel->formatFlag) {
+		cerr << diskname << " has " << header[1] << " tracks of "
+		     << header[2] << " sectors, not " << tracks << " of "
+		     << perTrack << "; use -f to remake it (losing its "
+		     << "contents), or leave out -dg\n";
+		Abort();
+	    }
+#endif
+	    DEBUG(dbgDisk, "Disk geometry changed, making a new disk.");
+	    Close(fileno);
+	    fileno = -1;
+	}
+    }
+    if (fileno < 0) {			// file doesn't exist, create it
+	if (tracks == 0) {
+	    tracks = DefaultNumTracks;
+	    perTrack = DefaultSectorsPerTrack;
+	}
         fileno = OpenForWrite(diskname);
-	magicNum = MagicNumber;  
-	WriteFile(fileno, (char *) &magicNum, MagicSize); // write magic number
+	header[0] = GeometryMagicNumber;
+	header[1] = tracks;
+	header[2] = perTrack;
+	headerSize = GeometrySize;
+	WriteFile(fileno, (char *) header, headerSize); // write magic number
 
 	// need to write at end of file, so that reads will not return EOF
-        Lseek(fileno, DiskSize - sizeof(int), 0);	
+        Lseek(fileno, headerSize + tracks * perTrack * SectorSize
+						- sizeof(int), 0);	
 	WriteFile(fileno, (char *)&tmp, sizeof(int));  
     }
+
+    NumTracks = tracks;
+    SectorsPerTrack = perTrack;
+    NumSectors = tracks * perTrack;
+    DEBUG(dbgDisk, "Disk has " << NumTracks << " tracks of " << SectorsPerTrack << " sectors.");
+
+    imageSize = headerSize + NumSectors * SectorSize;
+    if (kernel->diskMapped)
+	image = MapFile(fileno, imageSize);
+    else
+	image = NULL;
     active = FALSE;
 }
 
@@ -72,9 +137,27 @@ Disk::Disk(CallBackObj *toCall)
 
 Disk::~Disk()
 {
+    if (image != NULL) {
+	SyncMappedFile(image, imageSize);
+	UnmapFile(image, imageSize);
+    }
     Close(fileno);
 }
 
+//----------------------------------------------------------------------
+// Disk::Sync()
+// 	If the disk is mapped into memory, write the sectors changed in
+//	the mapping out to the UNIX file.  Otherwise every write has
+//	already gone to the file, and there is nothing to do.
+//----------------------------------------------------------------------
+
+void
+Disk::Sync()
+{
+    if (image != NULL)
+	SyncMappedFile(image, imageSize);
+}
+
 //----------------------------------------------------------------------
 // Disk::PrintSector()
 // 	Dump the data in a disk read/write request, for debugging.
@@ -113,39 +196,80 @@ PrintSector (bool writing, int sector, char *data)
 void
 Disk::ReadRequest(int sectorNumber, char* data)
 {
-    int ticks = ComputeLatency(sectorNumber, FALSE);
+    ReadRequest(sectorNumber, 1, &data);
+}
+
+void
+Disk::WriteRequest(int sectorNumber, char* data)
+{
+    WriteRequest(sectorNumber, 1, &data);
+}
+
+//----------------------------------------------------------------------
+// Disk::ReadRequest/WriteRequest
+// 	Simulate a request to read/write a run of consecutive disk
+//	sectors.  Only one interrupt happens, when the whole run is done.
+//
+//	"sectorNumber" -- the first disk sector to read/write
+//	"count" -- how many sectors to read/write
+//	"data" -- one buffer per sector: the bytes to be written, or the
+//		buffer to hold the incoming bytes
+//----------------------------------------------------------------------
+
+void
+Disk::ReadRequest(int sectorNumber, int count, char** data)
+{
+    int trackStart;
+    int ticks = RunLatency(sectorNumber, count, FALSE, &trackStart);
 
     ASSERT(!active);				// only one request at a time
-    ASSERT((sectorNumber >= 0) && (sectorNumber < NumSectors));
+    ASSERT((sectorNumber >= 0) && (count > 0) &&
+				(sectorNumber + count <= NumSectors));
     
-    DEBUG(dbgDisk, "Reading from sector " << sectorNumber);
-    Lseek(fileno, SectorSize * sectorNumber + MagicSize, 0);
-    Read(fileno, data, SectorSize);
-    if (debug->IsEnabled('d'))
-	PrintSector(FALSE, sectorNumber, data);
+    DEBUG(dbgDisk, "Reading from sector " << sectorNumber << ", count " << count);
+    if (image == NULL)
+	Lseek(fileno, SectorSize * sectorNumber + headerSize, 0);
+    for (int i = 0; i < count; i++) {
+	if (image != NULL)
+	    bcopy(image + headerSize + SectorSize * (sectorNumber + i),
+							data[i], SectorSize);
+	else
+	    Read(fileno, data[i], SectorSize);
+	if (debug->IsEnabled('d'))
+	    PrintSector(FALSE, sectorNumber + i, data[i]);
+    }
     
     active = TRUE;
-    UpdateLast(sectorNumber);
+    UpdateLast(sectorNumber, count, trackStart);
     kernel->stats->numDiskReads++;
     kernel->interrupt->Schedule(this, ticks, DiskInt);
 }
 
 void
-Disk::WriteRequest(int sectorNumber, char* data)
+Disk::WriteRequest(int sectorNumber, int count, char** data)
 {
-    int ticks = ComputeLatency(sectorNumber, TRUE);
+    int trackStart;
+    int ticks = RunLatency(sectorNumber, count, TRUE, &trackStart);
 
     ASSERT(!active);
-    ASSERT((sectorNumber >= 0) && (sectorNumber < NumSectors));
+    ASSERT((sectorNumber >= 0) && (count > 0) &&
+				(sectorNumber + count <= NumSectors));
     
-    DEBUG(dbgDisk, "Writing to sector " << sectorNumber);
-    Lseek(fileno, SectorSize * sectorNumber + MagicSize, 0);
-    WriteFile(fileno, data, SectorSize);
-    if (debug->IsEnabled('d'))
-	PrintSector(TRUE, sectorNumber, data);
+    DEBUG(dbgDisk, "Writing to sector " << sectorNumber << ", count " << count);
+    if (image == NULL)
+	Lseek(fileno, SectorSize * sectorNumber + headerSize, 0);
+    for (int i = 0; i < count; i++) {
+	if (image != NULL)
+	    bcopy(data[i], image + headerSize + SectorSize * (sectorNumber + i),
+								SectorSize);
+	else
+	    WriteFile(fileno, data[i], SectorSize);
+	if (debug->IsEnabled('d'))
+	    PrintSector(TRUE, sectorNumber + i, data[i]);
+    }
     
     active = TRUE;
-    UpdateLast(sectorNumber);
+    UpdateLast(sectorNumber, count, trackStart);
     kernel->stats->numDiskWrites++;
     kernel->interrupt->Schedule(this, ticks, DiskInt);
 }
@@ -249,20 +373,68 @@ Disk::ComputeLatency(int newSector, bool writing)
     return(seek + rotation + RotationTime);
 }
 
+//----------------------------------------------------------------------
+// Disk::RunLatency()
+// 	Return how long will it take to read/write "count" consecutive
+//	sectors starting at newSector, from the current position of the
+//	disk head.
+//
+//	The first sector costs the same as a single sector request.  Each
+//	following sector on the same track comes under the head right
+//	after the one before it, so costs only its transfer time.  Moving
+//	on to the next track costs a one track seek, plus the rotational
+//	delay until the wanted sector comes around.
+//
+//	"trackStart" is set to how long from now the head settles on the
+//	last track of the run, or 0 if the run stays on one track.
+//----------------------------------------------------------------------
+
+int
+Disk::RunLatency(int newSector, int count, bool writing, int *trackStart)
+{
+    int now = kernel->stats->totalTicks;
+    int ticks = ComputeLatency(newSector, writing);
+
+    *trackStart = 0;
+    for (int sector = newSector + 1; sector < newSector + count; sector++) {
+	if ((sector % SectorsPerTrack) != 0) {
+	    ticks += RotationTime;
+	} else {
+	    int when = now + ticks + SeekTime;
+	    int rotation = (RotationTime - (when % RotationTime)) % RotationTime;
+
+	    *trackStart = ticks + SeekTime + rotation;
+	    rotation += ModuloDiff(sector, (when + rotation) / RotationTime)
+							* RotationTime;
+	    ticks += SeekTime + rotation + RotationTime;
+	}
+    }
+    if (count > 1) {
+        DEBUG(dbgDisk, "Run latency = " << ticks);
+    }
+    return ticks;
+}
+
 //----------------------------------------------------------------------
 // Disk::UpdateLast
 //   	Keep track of the most recently requested sector.  So we can know
 //	what is in the track buffer.
+//
+//	"newSector", "count" -- the run of sectors just requested
+//	"trackStart" -- when (from now) the head got to the track of the
+//		last sector in the run, if the run crossed tracks
 //----------------------------------------------------------------------
 
 void
-Disk::UpdateLast(int newSector)
+Disk::UpdateLast(int newSector, int count, int trackStart)
 {
     int rotate;
     int seek = TimeToSeek(newSector, &rotate);
     
     if (seek != 0)
 	bufferInit = kernel->stats->totalTicks + seek + rotate;
-    lastSector = newSector;
+    if (trackStart != 0)
+	bufferInit = kernel->stats->totalTicks + trackStart;
+    lastSector = newSector + count - 1;
     DEBUG(dbgDisk, "Updating last sector = " << lastSector << " , " << bufferInit);
 }
@@ -34,6 +34,12 @@
 // and an interrupt is invoked later to signal that the operation completed.
 //
 // The physical disk is in fact simulated via operations on a UNIX file.
+// The number of tracks, and of sectors per track, are not fixed: they
+// are kept in a header at the front of the UNIX file, and picked (by
+// the -dg flag, or by default) when the file is first created.
+// With the -dm flag, the file is mapped into memory, and sectors are
+// read and written by copying to/from the mapping rather than with
+// a system call per sector.
 //
 // To make life a little more realistic, the simulated time for
 // each operation reflects a "track buffer" -- RAM to store the contents
@@ -46,12 +52,21 @@
 // disks these days now come with a track buffer.
 //
 // The track buffer simulation can be disabled by compiling with -DNOTRACKBUF
+//
+// A single request may also transfer several consecutive sectors.  Once
+// the head is at the first of them, the rest pass under the head one
+// after another, so they cost only their transfer time (plus a one track
+// seek whenever the run crosses onto the next track).
 
 const int SectorSize = 128;		// number of bytes per disk sector
-const int SectorsPerTrack  = 32;	// number of sectors per disk track 
-const int NumTracks = 32;		// number of tracks per disk
-const int NumSectors = (SectorsPerTrack * NumTracks);
-					// total # of sectors per disk
+extern int SectorsPerTrack;		// number of sectors per disk track 
+extern int NumTracks;			// number of tracks per disk
+extern int NumSectors;			// total # of sectors per disk
+					// (all three are set when the disk
+					// is opened)
+
+const int DefaultSectorsPerTrack = 32;	// geometry of a new disk, unless
+const int DefaultNumTracks = 32;	// the -dg flag says otherwise
 
 class Disk : public CallBackObj {
   public:
@@ -67,6 +82,16 @@ class Disk : public CallBackObj {
     					// Only one request allowed at a time!
     void WriteRequest(int sectorNumber, char* data);
 
+    void ReadRequest(int sectorNumber, int count, char** data);
+    void WriteRequest(int sectorNumber, int count, char** data);
+    					// Read/write "count" consecutive 
+					// sectors, starting at sectorNumber,
+					// to/from the buffers data[0..count-1],
+					// as a single request.
+
+    void Sync();			// Make sure everything written so
+					// far is in the UNIX file
+
     void CallBack();			// Invoked when disk request 
 					// finishes. In turn calls, callWhenDone.
 
@@ -77,6 +102,11 @@ class Disk : public CallBackObj {
 
   private:
     int fileno;				// UNIX file number for simulated disk 
+    int headerSize;			// # of bytes before sector 0 in the
+					// UNIX file
+    char *image;			// The UNIX file mapped into memory,
+					// NULL if it isn't mapped
+    int imageSize;			// # of bytes mapped
     char diskname[32];			// name of simulated disk's file
     CallBackObj *callWhenDone;		// Invoke when any disk request finishes
     bool active;     			// Is a disk operation in progress?
@@ -86,7 +116,9 @@ class Disk : public CallBackObj {
 
     int TimeToSeek(int newSector, int *rotate); // time to get to the new track
     int ModuloDiff(int to, int from);        // # sectors between to and from
-    void UpdateLast(int newSector);
+    int RunLatency(int newSector, int count, bool writing, int *trackStart);
+					// time to transfer a run of sectors
+    void UpdateLast(int newSector, int count, int trackStart);
 };
 
 #endif // DISK_H
@@ -232,10 +232,15 @@ Interrupt::Idle()
 //----------------------------------------------------------------------
 // Interrupt::Halt
 // 	Shut down Nachos cleanly, printing out performance statistics.
+//
+//	Any disk sectors still dirty in the cache are written back
+//	first, while the kernel is still intact enough to do I/O.
 //----------------------------------------------------------------------
 void
 Interrupt::Halt()
 {
+    kernel->Sync();
+
 	// MP4 mod tag
 	/*
     cout << "Machine halting!\n\n";
@@ -313,6 +318,60 @@ Interrupt::ReadFromFileId(char *buffer, int size, OpenFileId id)
     return kernel->ReadFromFileId(buffer, size, id);
 }
 
+//----------------------------------------------------------------------
+// Interrupt::WriteAtFileId
+//  Write string to target file, starting at a given position, without
+//  moving the file's seek position.
+//
+// Returns:
+//  Number of chars written to the file.
+// Parameters:
+//  (buffer)   -- char pointer points to the string you want to write.
+//  (size)     -- Size of the char you want to write.
+//  (position) -- Where in the file to start writing.
+//  (id)       -- file id of target file.
+//----------------------------------------------------------------------
+int
+Interrupt::WriteAtFileId(char *buffer, int size, int position, OpenFileId id)
+{
+    return kernel->WriteAtFileId(buffer, size, position, id);
+}
+
+//----------------------------------------------------------------------
+// Interrupt::ReadAtFileId
+//  Read char from target file, starting at a given position, without
+//  moving the file's seek position.
+//
+// Returns:
+//  Number of chars read from the file.
+// Parameters:
+//  (buffer)   -- char pointer points to the string you want to read to.
+//  (size)     -- Size of the char you want to read.
+//  (position) -- Where in the file to start reading.
+//  (id)       -- file id of target file.
+//----------------------------------------------------------------------
+int
+Interrupt::ReadAtFileId(char *buffer, int size, int position, OpenFileId id)
+{
+    return kernel->ReadAtFileId(buffer, size, position, id);
+}
+
+//----------------------------------------------------------------------
+// Interrupt::SeekFileId
+//  Move the seek position of target file.
+//
+// Returns:
+//  Seek status.
+// Parameters:
+//  (position) -- Where in the file the next Read or Write starts.
+//  (id)       -- file id of target file.
+//----------------------------------------------------------------------
+int
+Interrupt::SeekFileId(int position, OpenFileId id)
+{
+    return kernel->SeekFileId(position, id);
+}
+
 //----------------------------------------------------------------------
 // Interrupt::CloseFileId
 //  Close file specify by file id.
@@ -328,6 +387,16 @@ Interrupt::CloseFileId(OpenFileId id)
     return kernel->CloseFileId(id);
 }
 
+//----------------------------------------------------------------------
+// Interrupt::Sync
+//  Write back any disk sectors held dirty in the kernel's cache.
+//----------------------------------------------------------------------
+void
+Interrupt::Sync()
+{
+    kernel->Sync();
+}
+
 //----------------------------------------------------------------------
 // Interrupt::Schedule
 // 	Arrange for the CPU to be interrupted when simulated time
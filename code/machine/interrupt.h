@@ -111,7 +111,11 @@ class Interrupt {
     OpenFileId OpenFile(char *filename);
     int WriteToFileId(char *buffer, int size, OpenFileId id);
     int ReadFromFileId(char *buffer, int size, OpenFileId id);
+    int WriteAtFileId(char *buffer, int size, int position, OpenFileId id);
+    int ReadAtFileId(char *buffer, int size, int position, OpenFileId id);
+    int SeekFileId(int position, OpenFileId id);
     int CloseFileId(OpenFileId id);
+    void Sync();
 
     
 
@@ -20,6 +20,8 @@ Statistics::Statistics()
 {
     totalTicks = idleTicks = systemTicks = userTicks = 0;
     numDiskReads = numDiskWrites = 0;
+    numCacheHits = numCacheMisses = numReadAheads = 0;
+    numDiskSeekTracks = 0;
     numConsoleCharsRead = numConsoleCharsWritten = 0;
     numPageFaults = numPacketsSent = numPacketsRecvd = 0;
 }
@@ -36,7 +38,11 @@ Statistics::Print()
     cout << "Ticks: total " << totalTicks << ", idle " << idleTicks;
 		cout << ", system " << systemTicks << ", user " << userTicks <<"\n";
     cout << "Disk I/O: reads " << numDiskReads;
-		cout << ", writes " << numDiskWrites << "\n";
+		cout << ", writes " << numDiskWrites;
+		cout << ", tracks seeked " << numDiskSeekTracks << "\n";
+    cout << "Disk cache: hits " << numCacheHits;
+		cout << ", misses " << numCacheMisses;
+		cout << ", read ahead " << numReadAheads << "\n";
 		cout << "Console I/O: reads " << numConsoleCharsRead;
     cout << ", writes " << numConsoleCharsWritten << "\n";
     cout << "Paging: faults " << numPageFaults << "\n";
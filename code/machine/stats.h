@@ -30,6 +30,12 @@ class Statistics {
 
     int numDiskReads;		// number of disk read requests
     int numDiskWrites;		// number of disk write requests
+    int numCacheHits;		// number of sector reads found in the cache
+    int numCacheMisses;		// number of sector reads that went to disk
+    int numReadAheads;		// number of sectors read into the cache
+				// before they were asked for
+    int numDiskSeekTracks;	// total number of tracks the disk head
+				// moved across between requests
     int numConsoleCharsRead;	// number of characters read from the keyboard
     int numConsoleCharsWritten; // number of characters written to the display
     int numPageFaults;		// number of virtual memory page faults
@@ -6,3 +6,5 @@ make
 ../build.linux/nachos -p /file1
 ../build.linux/nachos -cp FS_test2 /FS_test2
 ../build.linux/nachos -e /FS_test2
+../build.linux/nachos -cp FS_test3 /FS_test3
+../build.linux/nachos -e /FS_test3
@@ -0,0 +1,21 @@
+# Create must not leak sectors when it fails after growing the directory.
+#
+# The names below are long enough that only four fit in a directory
+# block, and all hash to the same block even after it is split, so the
+# fifth Create grows the root directory by a block and then fails
+# anyway.  The free map must come out just as it was before.
+N=../build.linux/nachos
+X=xxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxx
+echo x > split.tmp
+$N -f
+for i in 0 2 4 6; do $N -cp split.tmp /$X$i; done
+$N -l /
+$N -D | grep -A1 "Bitmap set" > split.before
+$N -cp split.tmp /${X}8
+$N -D | grep -A1 "Bitmap set" > split.after
+if cmp -s split.before split.after; then
+    echo "PASS: free map unchanged by the failed Create"
+else
+    echo "FAIL: the failed Create changed the free map"
+fi
+rm -f split.tmp split.before split.after
@@ -0,0 +1,39 @@
+#include "syscall.h"
+#include "bufio.h"
+
+BFile f;
+char data[300];
+char check[300];
+
+int main(void)
+{
+	// like FS_test1 and FS_test2, but through bufio, so that both
+	// the buffered path and WriteV/ReadV get used
+	int success = Create("/file3", 0);
+	int i, c;
+	if (success != 1) MSG("Failed on creating file");
+	if (!BOpen(&f, "/file3")) MSG("Failed on opening file");
+	for (i = 0; i < 1000; ++i) {
+		if (BPutc(&f, 'a' + i % 26) != 1) MSG("Failed on writing file");
+	}
+	for (i = 0; i < 300; ++i)
+		data[i] = '0' + i % 10;
+	// the buffer is partly full, so this goes out with WriteV
+	if (BWrite(&f, data, 300) != 300) MSG("Failed on writing file");
+	if (!BClose(&f)) MSG("Failed on closing file");
+
+	if (!BOpen(&f, "/file3")) MSG("Failed on opening file");
+	for (i = 0; i < 1000; ++i) {
+		c = BGetc(&f);
+		if (c != 'a' + i % 26) MSG("Failed: reading wrong result");
+	}
+	// more than is buffered, so this comes in with ReadV
+	if (BRead(&f, check, 300) != 300) MSG("Failed on reading file");
+	for (i = 0; i < 300; ++i) {
+		if (check[i] != data[i]) MSG("Failed: reading wrong result");
+	}
+	if (BGetc(&f) != -1) MSG("Failed: file too long");
+	if (!BClose(&f)) MSG("Failed on closing file");
+	MSG("Passed! ^_^");
+	Halt();
+}
@@ -0,0 +1,125 @@
+/* bufio.c
+ *	Buffered file I/O for user programs.  See bufio.h.
+ */
+
+#include "syscall.h"
+#include "bufio.h"
+
+/* There is no C library for user programs, so no bcopy. */
+
+static void
+Copy(char *from, char *to, int size)
+{
+    int i;
+
+    for (i = 0; i < size; i++)
+	to[i] = from[i];
+}
+
+int
+BOpen(BFile *f, char *name)
+{
+    f->id = Open(name);
+    f->count = 0;
+    f->next = 0;
+    return (f->id > 0);
+}
+
+int
+BFlush(BFile *f)
+{
+    int count = f->count;
+
+    if (count == 0)
+	return 1;
+    f->count = 0;
+    return (Write(f->buf, count, f->id) == count);
+}
+
+int
+BWrite(BFile *f, char *data, int size)
+{
+    IOVec iov[2];
+    int pending = f->count;
+    int written;
+
+    if (f->count + size <= BufSize) {	/* room in the buffer */
+	Copy(data, &f->buf[f->count], size);
+	f->count += size;
+	return size;
+    }
+
+    /* too big: write out the buffer and the new data together */
+    iov[0].buf = f->buf;
+    iov[0].len = pending;
+    iov[1].buf = data;
+    iov[1].len = size;
+    written = WriteV(iov, 2, f->id);
+    f->count = 0;
+    if (written < pending)
+	return 0;
+    return written - pending;
+}
+
+int
+BPutc(BFile *f, char c)
+{
+    if (f->count == BufSize && !BFlush(f))
+	return 0;
+    f->buf[f->count++] = c;
+    return 1;
+}
+
+int
+BRead(BFile *f, char *data, int size)
+{
+    IOVec iov[2];
+    int got = f->count - f->next;
+    int read;
+
+    if (got >= size) {			/* all of it is in the buffer */
+	Copy(&f->buf[f->next], data, size);
+	f->next += size;
+	return size;
+    }
+
+    /* take what is buffered, then read the rest and refill the
+     * buffer together */
+    Copy(&f->buf[f->next], data, got);
+    iov[0].buf = &data[got];
+    iov[0].len = size - got;
+    iov[1].buf = f->buf;
+    iov[1].len = BufSize;
+    read = ReadV(iov, 2, f->id);
+    if (read < 0)
+	read = 0;
+    if (read <= size - got) {
+	f->count = f->next = 0;
+	return got + read;
+    }
+    f->count = read - (size - got);
+    f->next = 0;
+    return size;
+}
+
+int
+BGetc(BFile *f)
+{
+    if (f->next == f->count) {
+	f->count = Read(f->buf, BufSize, f->id);
+	f->next = 0;
+	if (f->count <= 0) {
+	    f->count = 0;
+	    return -1;
+	}
+    }
+    return (unsigned char) f->buf[f->next++];
+}
+
+int
+BClose(BFile *f)
+{
+    int flushed = BFlush(f);
+
+    return (Close(f->id) == 1 && flushed);
+}
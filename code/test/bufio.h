@@ -0,0 +1,58 @@
+/* bufio.h
+ *	Buffered file I/O for user programs.
+ *
+ *	Every Read or Write is a trap into the Nachos kernel, and a Write
+ *	of a few bytes makes the kernel read in, patch and write back a
+ *	whole disk sector.  A program that reads or writes a little at a
+ *	time should use these routines instead: they keep a buffer in the
+ *	program, and only call the kernel when it is full (or empty), or
+ *	when asked to with BFlush.  Where the buffer and the caller's data
+ *	both have to go, they go with a single WriteV or ReadV.
+ *
+ *	A BFile is either read from or written to, not both.  There is no
+ *	malloc for user programs, so the caller provides the BFile.
+ */
+
+#ifndef BUFIO_H
+#define BUFIO_H
+
+#include "syscall.h"
+
+#define BufSize		256	/* bytes buffered per file */
+
+typedef struct {
+    OpenFileId id;		/* the open file */
+    char buf[BufSize];		/* data read ahead, or not yet written */
+    int count;			/* number of bytes in "buf" */
+    int next;			/* when reading, the next byte of "buf"
+				 * to hand out */
+} BFile;
+
+/* Open the file "name" into "f".  Return 1 on success, 0 if the file
+ * could not be opened.
+ */
+int BOpen(BFile *f, char *name);
+
+/* Write "size" bytes from "data", or one character, to "f".  Return
+ * the number of bytes written.
+ */
+int BWrite(BFile *f, char *data, int size);
+int BPutc(BFile *f, char c);
+
+/* Read up to "size" bytes from "f" into "data".  Return the number of
+ * bytes read, 0 at the end of the file.
+ */
+int BRead(BFile *f, char *data, int size);
+
+/* Return the next character of "f", or -1 at the end of the file. */
+int BGetc(BFile *f);
+
+/* Write any buffered data to the file.  Return 1 on success, 0 if
+ * some of it could not be written.
+ */
+int BFlush(BFile *f);
+
+/* Flush "f", then close the file.  Return 1 on success. */
+int BClose(BFile *f);
+
+#endif /* BUFIO_H */
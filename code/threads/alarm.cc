@@ -1,8 +1,7 @@
 // alarm.cc
 //	Routines to use a hardware timer device to provide a
-//	software alarm clock.  For now, we just provide time-slicing.
-//
-//	Not completely implemented.
+//	software alarm clock: time-slicing, and the ability for a
+//	thread to sleep until a given time.
 //
 // Copyright (c) 1992-1996 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation 
@@ -25,6 +24,42 @@ Alarm::Alarm(bool doRandom)
     timer = new Timer(doRandom, this);
 }
 
+//----------------------------------------------------------------------
+// Alarm::WaitUntil
+//      Put the current thread to sleep until "x" ticks from now.
+//
+//	The wakeup is a one-time interrupt of its own, rather than a
+//	check made on every tick of the timer, because once no thread
+//	is ready to run the timer is turned off for good (see
+//	Kernel::PrepareToEnd).  A pending wakeup also keeps Nachos from
+//	halting until the sleeping thread has had its turn.
+//
+//	"x" -- how long to sleep, in simulated ticks
+//----------------------------------------------------------------------
+
+void
+Alarm::WaitUntil(int x)
+{
+    IntStatus oldLevel = kernel->interrupt->SetLevel(IntOff);
+    SleepingThread sleeper(kernel->currentThread);
+
+    kernel->interrupt->Schedule(&sleeper, x, TimerInt);
+    kernel->currentThread->Sleep(FALSE);
+    (void) kernel->interrupt->SetLevel(oldLevel);
+}
+
+//----------------------------------------------------------------------
+// SleepingThread::CallBack
+//	Interrupt handler for the end of a WaitUntil: put the sleeping
+//	thread back on the ready list.
+//----------------------------------------------------------------------
+
+void
+SleepingThread::CallBack()
+{
+    kernel->scheduler->ReadyToRun(thread);
+}
+
 //----------------------------------------------------------------------
 // Alarm::CallBack
 //	Software interrupt handler for the timer device. The timer device is
@@ -8,8 +8,6 @@
 //	From this, we provide the ability for a thread to be
 //	woken up after a delay; we also provide time-slicing.
 //
-//	NOTE: this abstraction is not completely implemented.
-//
 // Copyright (c) 1992-1996 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation 
 // of liability and disclaimer of warranty provisions.
@@ -22,6 +20,21 @@
 #include "callback.h"
 #include "timer.h"
 
+class Thread;
+
+// The following class records a thread sleeping in Alarm::WaitUntil.
+// It is the handler for a one-time interrupt, scheduled for the time
+// at which the thread should be woken up.
+class SleepingThread : public CallBackObj {
+  public:
+    SleepingThread(Thread *t) { thread = t; }
+
+    void CallBack();		// wake up the thread
+
+  private:
+    Thread *thread;		// the thread to wake up
+};
+
 // The following class defines a software alarm clock. 
 class Alarm : public CallBackObj {
   public:
@@ -30,7 +43,6 @@ class Alarm : public CallBackObj {
     ~Alarm() { delete timer; }
     
     void WaitUntil(int x);	// suspend execution until time > now + x
-                                // this method is not yet implemented
 	
 	void Disable() { timer->Disable(); } //2015.11.25
 
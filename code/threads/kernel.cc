@@ -15,6 +15,7 @@
 #include "libtest.h"
 #include "string.h"
 #include "synchdisk.h"
+#include "hdrtable.h"
 #include "post.h"
 #include "synchconsole.h"
 
@@ -30,6 +31,12 @@ Kernel::Kernel(int argc, char **argv)
     debugUserProg = FALSE;
     consoleIn = NULL;          // default is stdin
     consoleOut = NULL;         // default is stdout
+    printStats = FALSE;
+    writeBack = FALSE;
+    diskPolicy = NULL;		// default is C-LOOK
+    diskTracks = 0;		// default is the disk's own geometry
+    diskSectorsPerTrack = 0;
+    diskMapped = FALSE;
 #ifndef FILESYS_STUB
     formatFlag = FALSE;
 #endif
@@ -39,6 +46,8 @@ Kernel::Kernel(int argc, char **argv)
 								
 	// MP4 mod tag
 	execfileNum = 0; // dummy operation to keep valgrind happy
+	threadNum = 0;
+	daemonNum = -1;
 								
     for (int i = 1; i < argc; i++) {
         if (strcmp(argv[i], "-rs") == 0) {
@@ -49,7 +58,30 @@ Kernel::Kernel(int argc, char **argv)
 	    	i++;
         } else if (strcmp(argv[i], "-s") == 0) {
             debugUserProg = TRUE;
+        } else if (strcmp(argv[i], "-ps") == 0) {
+            printStats = TRUE;
+        } else if (strcmp(argv[i], "-wb") == 0) {
+            writeBack = TRUE;
+        } else if (strcmp(argv[i], "-ds") == 0) {
+            ASSERT(i + 1 < argc);
+            diskPolicy = argv[i + 1];
+            if (strcmp(diskPolicy, "fcfs") != 0
+                    && strcmp(diskPolicy, "sstf") != 0
+                    && strcmp(diskPolicy, "clook") != 0) {
+                cout << "Partial usage: nachos [-ds fcfs|sstf|clook]\n";
+                Exit(1);
+            }
+            i++;
+        } else if (strcmp(argv[i], "-dg") == 0) {
+            ASSERT(i + 2 < argc);
+            diskTracks = atoi(argv[i + 1]);
+            diskSectorsPerTrack = atoi(argv[i + 2]);
+            ASSERT(diskTracks > 0 && diskSectorsPerTrack > 0);
+            i += 2;
+        } else if (strcmp(argv[i], "-dm") == 0) {
+            diskMapped = TRUE;
 		} else if (strcmp(argv[i], "-e") == 0) {
+			ASSERT(i + 1 < argc && execfileNum < 9);	// room in execfile
         	execfile[++execfileNum]= argv[++i];
 			cout << execfile[execfileNum] << "\n";
 		} else if (strcmp(argv[i], "-ci") == 0) {
@@ -74,7 +106,9 @@ Kernel::Kernel(int argc, char **argv)
             i++;
         } else if (strcmp(argv[i], "-u") == 0) {
             cout << "Partial usage: nachos [-rs randomSeed]\n";
-	   		cout << "Partial usage: nachos [-s]\n";
+	   		cout << "Partial usage: nachos [-s] [-ps] [-wb]\n";
+	   		cout << "Partial usage: nachos [-ds fcfs|sstf|clook]\n";
+	   		cout << "Partial usage: nachos [-dg numTracks sectorsPerTrack] [-dm]\n";
             cout << "Partial usage: nachos [-ci consoleIn] [-co consoleOut]\n";
 #ifndef FILESYS_STUB
 	    	cout << "Partial usage: nachos [-nf]\n";
@@ -84,6 +118,31 @@ Kernel::Kernel(int argc, char **argv)
     }
 }
 
+//----------------------------------------------------------------------
+// DiskFlusher
+// 	Body of the kernel thread that, in write-back mode, periodically
+//	writes the dirty sectors in the disk cache back to the disk
+//	(see SynchDisk::FlushDaemon).
+//----------------------------------------------------------------------
+
+static void
+DiskFlusher(void *dummy)
+{
+    kernel->synchDisk->FlushDaemon();
+}
+
+//----------------------------------------------------------------------
+// DiskReader
+// 	Body of the kernel thread that reads disk sectors into the disk
+//	cache ahead of time (see SynchDisk::ReadAhead).
+//----------------------------------------------------------------------
+
+static void
+DiskReader(void *dummy)
+{
+    kernel->synchDisk->ReadAheadDaemon();
+}
+
 //----------------------------------------------------------------------
 // Kernel::Initialize
 // 	Initialize Nachos global data structures.  Separate from the 
@@ -109,10 +168,17 @@ Kernel::Initialize()
     machine = new Machine(debugUserProg);
     synchConsoleIn = new SynchConsoleInput(consoleIn); // input from stdin
     synchConsoleOut = new SynchConsoleOutput(consoleOut); // output to stdout
-    synchDisk = new SynchDisk();    //
+    synchDisk = new SynchDisk(writeBack, diskPolicy);
+    if (writeBack) {
+	Thread *flusher = new Thread("disk flusher", NewThreadID());
+	flusher->Fork((VoidFunctionPtr) DiskFlusher, (void *) NULL);
+    }
+    Thread *reader = new Thread("disk read-ahead", NewThreadID());
+    reader->Fork((VoidFunctionPtr) DiskReader, (void *) NULL);
 #ifdef FILESYS_STUB
     fileSystem = new FileSystem();
 #else
+    headerTable = new HeaderTable;	// before any file is opened
     fileSystem = new FileSystem(formatFlag);
 #endif // FILESYS_STUB
 
@@ -146,6 +212,9 @@ Kernel::PrepareToEnd()
 
 Kernel::~Kernel()
 {
+    if (printStats)
+	stats->Print();
+
     delete stats;
     delete interrupt;
     delete scheduler;
@@ -155,6 +224,9 @@ Kernel::~Kernel()
     delete synchConsoleOut;
     delete synchDisk;
     delete fileSystem;
+#ifndef FILESYS_STUB
+    delete headerTable;
+#endif
 	
 	// Mp4 mod tag
 	/*
@@ -296,6 +368,10 @@ void Kernel::ExecAll()
 
 int Kernel::Exec(char* name)
 {
+	if (threadNum >= 10) {		// no room left in t
+	    cerr << "Too many programs; " << name << " not run\n";
+	    return -1;
+	}
 	t[threadNum] = new Thread(name, threadNum);
 	t[threadNum]->space = new AddrSpace();
 	t[threadNum]->Fork((VoidFunctionPtr) &ForkExecute, (void *)t[threadNum]);
@@ -357,7 +433,31 @@ int Kernel::ReadFromFileId(char *buffer, int size, OpenFileId id)
     return fileSystem->ReadFromFileId(buffer, size, id);
 }
 
+int Kernel::WriteAtFileId(char *buffer, int size, int position, OpenFileId id)
+{
+    return fileSystem->WriteAtFileId(buffer, size, position, id);
+}
+
+int Kernel::ReadAtFileId(char *buffer, int size, int position, OpenFileId id)
+{
+    return fileSystem->ReadAtFileId(buffer, size, position, id);
+}
+
+int Kernel::SeekFileId(int position, OpenFileId id)
+{
+    return fileSystem->SeekFileId(position, id);
+}
+
 int Kernel::CloseFileId(OpenFileId id)
 {
     return fileSystem->CloseFileId(id);
 }
+
+void Kernel::Sync()
+{
+#ifndef FILESYS_STUB
+    fileSystem->Sync();
+#else
+    synchDisk->Flush();
+#endif
+}
@@ -24,6 +24,7 @@ class PostOfficeOutput;
 class SynchConsoleInput;
 class SynchConsoleOutput;
 class SynchDisk;
+class HeaderTable;
 
 
 
@@ -47,6 +48,8 @@ class Kernel {
     void ConsoleTest();         // interactive console self test
     void NetworkTest();         // interactive 2-machine network test
 	Thread* getThread(int threadID){return t[threadID];}    
+	int NewThreadID() { return daemonNum--; }	// for a kernel thread;
+						// never indexes t
 
 	#ifdef FILESYS_STUB	
 	int CreateFile(char* filename); // fileSystem call
@@ -55,7 +58,11 @@ class Kernel {
     OpenFileId OpenFile(char *filename);
     int WriteToFileId(char *buffer, int size, OpenFileId id);
     int ReadFromFileId(char *buffer, int size, OpenFileId id);
+    int WriteAtFileId(char *buffer, int size, int position, OpenFileId id);
+    int ReadAtFileId(char *buffer, int size, int position, OpenFileId id);
+    int SeekFileId(int position, OpenFileId id);
     int CloseFileId(OpenFileId id);
+    void Sync();			// write back dirty disk sectors
 
 // These are public for notational convenience; really, 
 // they're global variables used everywhere.
@@ -69,11 +76,18 @@ class Kernel {
     SynchConsoleInput *synchConsoleIn;
     SynchConsoleOutput *synchConsoleOut;
     SynchDisk *synchDisk;
+    HeaderTable *headerTable;	// file headers of the open files
     FileSystem *fileSystem;     
     PostOfficeInput *postOfficeIn;
     PostOfficeOutput *postOfficeOut;
 
     int hostName;               // machine identifier
+    int diskTracks;		// geometry for the disk, 0 to use
+    int diskSectorsPerTrack;	// whatever the disk already has
+    bool diskMapped;		// map the disk image into memory
+#ifndef FILESYS_STUB
+    bool formatFlag;          // format the disk if this is true
+#endif
 
   private:
 
@@ -81,14 +95,15 @@ class Kernel {
 	char*   execfile[10];
 	int execfileNum;
 	int threadNum;
+	int daemonNum;		// IDs for kernel threads count down from -1
     bool randomSlice;		// enable pseudo-random time slicing
     bool debugUserProg;         // single step user program
     double reliability;         // likelihood messages are dropped
     char *consoleIn;            // file to read console input from
     char *consoleOut;           // file to send console output to
-#ifndef FILESYS_STUB
-    bool formatFlag;          // format the disk if this is true
-#endif
+    bool printStats;		// print performance metrics at halt
+    bool writeBack;		// hold disk writes in the sector cache
+    char *diskPolicy;		// disk scheduling policy, NULL for default
 };
 
 
@@ -13,6 +13,16 @@
 //    -rs causes Yield to occur at random (but repeatable) spots
 //    -z prints the copyright message
 //    -s causes user programs to be executed in single-step mode
+//    -ps prints performance statistics when Nachos halts
+//    -wb holds disk writes in the sector cache, writing them back
+//	periodically and when Nachos halts
+//    -ds sets the disk scheduling policy: fcfs, sstf or clook (default)
+//    -dg sets the disk geometry (number of tracks, sectors per track);
+//	if the disk has some other geometry, Nachos refuses to start,
+//	unless -f is also given, in which case the old disk is thrown
+//	away and the new one formatted
+//    -dm maps the disk image into memory, instead of reading and
+//	writing it a sector at a time
 //    -x runs a user program
 //    -ci specify file for console input (stdin is the default)
 //    -co specify file for console output (stdout is the default)
@@ -95,9 +105,9 @@ Copy(char *from, char *to)
     fileLength = Tell(fd);
     Lseek(fd, 0, 0);
 
-// Create a Nachos file of the same length
+// Create an empty Nachos file; it grows as the data is written to it
     DEBUG('f', "Copying file " << from << " of size " << fileLength <<  " to file " << to);
-    if (!kernel->fileSystem->Create(to, fileLength, false)) {   // Create Nachos file
+    if (!kernel->fileSystem->Create(to, 0, false)) {   // Create Nachos file
         printf("Copy: couldn't create output file %s\n", to);
         Close(fd);
         return;
@@ -20,6 +20,8 @@
 #include "addrspace.h"
 #include "machine.h"
 #include "noff.h"
+#include "asyncio.h"
+#include <strings.h>
 
 //----------------------------------------------------------------------
 // SwapHeader
@@ -79,6 +81,13 @@ AddrSpace::AddrSpace()
     
     // zero out the entire address space
     bzero(kernel->machine->mainMemory, MemorySize);
+
+    for (int i = 0; i < MaxOpenFiles; i++)
+	fileIds[i] = -1;
+    freeFds = ~0U << 2;			// 0 and 1 are the console
+    for (int i = 0; i < MaxAsyncRequests; i++)
+	requests[i] = NULL;
+    freeTickets = ~0U;
 }
 
 //----------------------------------------------------------------------
@@ -311,6 +320,238 @@ AddrSpace::Translate(unsigned int vaddr, unsigned int *paddr, int isReadWrite)
     return NoException;
 }
 
+//----------------------------------------------------------------------
+// AddrSpace::UserBuffer
+//  Translate the user buffer of _size_ bytes at virtual address
+//  _vaddr_, so that a system call can read or write it in place,
+//  rather than copying it in or out a byte at a time.  Pages next to
+//  each other in the address space need not be next to each other
+//  in physical memory, so only the part of the buffer, from _vaddr_
+//  on, that is contiguous in memory can be used at once; its length
+//  is stored in _length_, and the caller translates the rest with
+//  another call.
+//  Return a pointer into main memory, or NULL if _vaddr_ cannot be
+//  accessed in _mode_ (0 for Read, 1 for Write).
+//----------------------------------------------------------------------
+char *
+AddrSpace::UserBuffer(unsigned int vaddr, int size, int mode, int *length)
+{
+    unsigned int paddr, next;
+    int count;
+
+    if (Translate(vaddr, &paddr, mode) != NoException)
+        return NULL;
+    count = PageSize - vaddr % PageSize;	// rest of the first page
+    while (count < size
+            && Translate(vaddr + count, &next, mode) == NoException
+            && next == paddr + count)
+        count += PageSize;
+    *length = min(count, size);
+    return &kernel->machine->mainMemory[paddr];
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::WriteFile
+// AddrSpace::ReadFile
+//  Write/read the user buffer of _size_ bytes at _buffer_ to/from the
+//  open file _fileId_ (an id from FileSystem::OpenFileForId), starting
+//  at byte _position_ of the file, or at the file's seek position if
+//  _position_ is -1.
+//
+//  The buffer is used in place, a physically contiguous piece at a
+//  time; the file system copies whole sectors straight between it
+//  and the disk cache.  These are called by the system calls, and by
+//  the threads doing asynchronous I/O for the program, so they use
+//  this address space rather than the current thread's.
+//
+//  Return the number of bytes written/read; fewer than _size_ if the
+//  disk fills up (end of file), or part of the buffer is not legal.
+//----------------------------------------------------------------------
+int
+AddrSpace::WriteFile(int buffer, int size, int position, OpenFileId fileId)
+{
+    int done = 0, length, count;
+    char *from;
+
+    while (done < size) {
+        from = UserBuffer(buffer + done, size - done, 0, &length);
+        if (from == NULL)
+            break;			// bad address
+        if (position == -1)
+            count = kernel->interrupt->WriteToFileId(from, length, fileId);
+        else
+            count = kernel->interrupt->WriteAtFileId(from, length,
+                                                position + done, fileId);
+        done += count;
+        if (count < length)
+            break;			// disk full
+    }
+    return done;
+}
+
+int
+AddrSpace::ReadFile(int buffer, int size, int position, OpenFileId fileId)
+{
+    int done = 0, length, count;
+    char *into;
+
+    while (done < size) {
+        into = UserBuffer(buffer + done, size - done, 1, &length);
+        if (into == NULL)
+            break;			// bad address
+        if (position == -1)
+            count = kernel->interrupt->ReadFromFileId(into, length, fileId);
+        else
+            count = kernel->interrupt->ReadAtFileId(into, length,
+                                                position + done, fileId);
+        done += count;
+        if (count < length)
+            break;			// end of file
+    }
+    return done;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::AllocFd
+// 	Give the file "fileId" (an id from FileSystem::OpenFileForId)
+//	the lowest numbered free file descriptor, and return it, or -1
+//	if every descriptor is in use.
+//
+//	The free descriptors are kept as bits in a word, so the lowest
+//	one is found with a single ffs rather than a search.
+//----------------------------------------------------------------------
+
+OpenFileId
+AddrSpace::AllocFd(OpenFileId fileId)
+{
+    int fd = ffs(freeFds) - 1;
+
+    if (fd < 0 || fd >= MaxOpenFiles)
+	return -1;			// too many files open
+    freeFds &= ~(1U << fd);
+    fileIds[fd] = fileId;
+    return fd;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::LookupFd
+// 	Return the file that the descriptor "fd" names, or -1 if "fd"
+//	is not an open file.
+//----------------------------------------------------------------------
+
+OpenFileId
+AddrSpace::LookupFd(OpenFileId fd)
+{
+    if (fd < 0 || fd >= MaxOpenFiles)
+	return -1;
+    return fileIds[fd];
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::FreeFd
+// 	Free the descriptor "fd", and return the file it named, for the
+//	caller to close; -1 if "fd" is not an open file.
+//----------------------------------------------------------------------
+
+OpenFileId
+AddrSpace::FreeFd(OpenFileId fd)
+{
+    OpenFileId fileId = LookupFd(fd);
+
+    if (fileId != -1) {
+	fileIds[fd] = -1;
+	freeFds |= 1U << fd;
+    }
+    return fileId;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::CloseFiles
+// 	Close every file the program left open, when it exits, once any
+//	asynchronous I/O still going on is done.  Requests the program
+//	never collected are thrown away.
+//
+//	This may block, so it is called by Exit, not by ~AddrSpace.
+//----------------------------------------------------------------------
+
+void
+AddrSpace::CloseFiles()
+{
+    WaitRequests(-1);
+    for (int ticket = 0; ticket < MaxAsyncRequests; ticket++)
+	if (requests[ticket] != NULL) {
+	    delete requests[ticket];
+	    RemoveRequest(ticket);
+	}
+    for (int fd = 0; fd < MaxOpenFiles; fd++)
+	if (fileIds[fd] != -1)
+	    kernel->interrupt->CloseFileId(FreeFd(fd));
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::AddRequest
+// 	Give the asynchronous read or write "request" the lowest free
+//	ticket, and return it, or -1 if there are already
+//	MaxAsyncRequests requests that have not been collected.
+//----------------------------------------------------------------------
+
+int
+AddrSpace::AddRequest(AsyncRequest *request)
+{
+    int ticket = ffs(freeTickets) - 1;
+
+    if (ticket < 0 || ticket >= MaxAsyncRequests)
+	return -1;			// too many outstanding
+    freeTickets &= ~(1U << ticket);
+    requests[ticket] = request;
+    return ticket;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::LookupRequest
+// 	Return the request that "ticket" names, or NULL if there is none.
+//----------------------------------------------------------------------
+
+AsyncRequest *
+AddrSpace::LookupRequest(int ticket)
+{
+    if (ticket < 0 || ticket >= MaxAsyncRequests)
+	return NULL;
+    return requests[ticket];
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::RemoveRequest
+// 	Free "ticket", once its request has been collected.  The caller
+//	deletes the request.
+//----------------------------------------------------------------------
+
+void
+AddrSpace::RemoveRequest(int ticket)
+{
+    ASSERT(LookupRequest(ticket) != NULL);
+    requests[ticket] = NULL;
+    freeTickets |= 1U << ticket;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::WaitRequests
+// 	Wait until every asynchronous request on the file "fileId", or
+//	on any file if "fileId" is -1, is done, so that the file can be
+//	closed.  The requests keep their tickets, for the program to
+//	collect.
+//----------------------------------------------------------------------
+
+void
+AddrSpace::WaitRequests(OpenFileId fileId)
+{
+    for (int i = 0; i < MaxAsyncRequests; i++)
+	if (requests[i] != NULL
+		&& (fileId == -1 || requests[i]->GetFileId() == fileId))
+	    requests[i]->Wait();
+}
+
+
 
 
 
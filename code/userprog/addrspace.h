@@ -17,6 +17,13 @@
 #include "filesys.h"
 
 #define UserStackSize		1024 	// increase this as necessary!
+#define MaxOpenFiles		32	// open file descriptors per address
+					// space, counting the console; at
+					// most the bits in an unsigned int
+#define MaxAsyncRequests	8	// asynchronous reads and writes per
+					// address space not yet collected
+
+class AsyncRequest;
 
 class AddrSpace {
   public:
@@ -39,11 +46,53 @@ class AddrSpace {
     // is 0 for Read, 1 for Write.
     ExceptionType Translate(unsigned int vaddr, unsigned int *paddr, int mode);
 
+    // Find the user buffer of _size_ bytes at _vaddr_ in
+    // physical memory; _length_ is set to how much of it is
+    // contiguous there.  NULL if _vaddr_ is not legal.
+    char *UserBuffer(unsigned int vaddr, int size, int mode, int *length);
+
+    // Write/read _size_ bytes between the user buffer at _buffer_
+    // and the open file _fileId_, in place, starting at byte
+    // _position_ of the file, or at its seek position if _position_
+    // is -1.  Return the number of bytes moved.
+    int WriteFile(int buffer, int size, int position, OpenFileId fileId);
+    int ReadFile(int buffer, int size, int position, OpenFileId fileId);
+
+    // Each address space has its own file descriptors, each naming
+    // a file in the file system's table of files opened by user
+    // programs (see filesys.h).  Descriptors 0 and 1 are the console.
+    OpenFileId AllocFd(OpenFileId fileId);	// Give "fileId" the lowest
+					// free descriptor; -1 if none
+    OpenFileId LookupFd(OpenFileId fd);	// The file "fd" names, or -1
+					// if "fd" is not open
+    OpenFileId FreeFd(OpenFileId fd);	// Free "fd", and return the
+					// file it named, or -1
+    void CloseFiles();			// Close every file still open
+
+    // Asynchronous reads and writes in progress (see asyncio.h) are
+    // named by tickets, handed out like file descriptors.
+    int AddRequest(AsyncRequest *request);
+					// Give "request" a ticket; -1 if
+					// too many are outstanding
+    AsyncRequest *LookupRequest(int ticket);
+					// The request "ticket" names, or
+					// NULL if there is none
+    void RemoveRequest(int ticket);	// Free "ticket"
+    void WaitRequests(OpenFileId fileId);
+					// Wait for every request on the
+					// file "fileId" (-1 for all files)
+					// to be done
+
   private:
     TranslationEntry *pageTable;	// Assume linear page table translation
 					// for now!
     unsigned int numPages;		// Number of pages in the virtual 
 					// address space
+    OpenFileId fileIds[MaxOpenFiles];	// The file each descriptor names
+    unsigned int freeFds;		// Bit "fd" is set if "fd" is free
+    AsyncRequest *requests[MaxAsyncRequests];
+					// The request each ticket names
+    unsigned int freeTickets;		// Bit "ticket" is set if it is free
 
     void InitRegisters();		// Initialize user-level CPU registers,
 					// before jumping to user code
@@ -0,0 +1,107 @@
+// asyncio.cc
+//	Routines for asynchronous file I/O by user programs.  See
+//	asyncio.h for how it works, and ksyscall.h for the system calls
+//	that use it.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "main.h"
+#include "addrspace.h"
+#include "synch.h"
+#include "asyncio.h"
+
+//----------------------------------------------------------------------
+// AsyncTransfer
+// 	Body of the kernel thread doing an asynchronous request.  Needed
+//	because Fork can't be given a member function.
+//----------------------------------------------------------------------
+
+static void
+AsyncTransfer(AsyncRequest *request)
+{
+    request->Transfer();
+}
+
+//----------------------------------------------------------------------
+// AsyncRequest::AsyncRequest
+// 	Set up an asynchronous read or write of "size" bytes, between
+//	the buffer at "buffer" in "space" and the file "fileId", starting
+//	at byte "position" of the file.
+//----------------------------------------------------------------------
+
+AsyncRequest::AsyncRequest(AddrSpace *space, int buffer, int size,
+			int position, OpenFileId fileId, bool isWrite)
+{
+    this->space = space;
+    this->buffer = buffer;
+    this->size = size;
+    this->position = position;
+    this->fileId = fileId;
+    writing = isWrite;
+    done = FALSE;
+    result = 0;
+    finished = new Semaphore("async request", 0);
+}
+
+//----------------------------------------------------------------------
+// AsyncRequest::~AsyncRequest
+// 	De-allocate a request, once its transfer is done.
+//----------------------------------------------------------------------
+
+AsyncRequest::~AsyncRequest()
+{
+    ASSERT(done);
+    delete finished;
+}
+
+//----------------------------------------------------------------------
+// AsyncRequest::Start
+// 	Fork a kernel thread to do the transfer, and let it run until it
+//	blocks, so that its first disk request is queued before the
+//	program goes on.  If the data is all in the sector cache, the
+//	transfer is done by the time we get back.
+//----------------------------------------------------------------------
+
+void
+AsyncRequest::Start()
+{
+    Thread *t = new Thread("async io", kernel->NewThreadID());
+
+    DEBUG(dbgSys, (writing ? "Async write of " : "Async read of ") << size
+		<< " bytes at " << position << " in file " << fileId);
+    t->Fork((VoidFunctionPtr) AsyncTransfer, (void *) this);
+    kernel->currentThread->Yield();
+}
+
+//----------------------------------------------------------------------
+// AsyncRequest::Transfer
+// 	Do the read or write, then wake up anyone waiting for it.
+//----------------------------------------------------------------------
+
+void
+AsyncRequest::Transfer()
+{
+    if (writing)
+	result = space->WriteFile(buffer, size, position, fileId);
+    else
+	result = space->ReadFile(buffer, size, position, fileId);
+    done = TRUE;
+    finished->V();
+}
+
+//----------------------------------------------------------------------
+// AsyncRequest::Wait
+// 	Wait until the transfer is done, and return the number of bytes
+//	read or written.  May be called any number of times.
+//----------------------------------------------------------------------
+
+int
+AsyncRequest::Wait()
+{
+    finished->P();
+    finished->V();			// let the next waiter through too
+    return result;
+}
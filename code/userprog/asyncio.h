@@ -0,0 +1,66 @@
+// asyncio.h
+//	Data structures for asynchronous file I/O by user programs.
+//
+//	A Read or Write system call blocks the program until the disk is
+//	done.  AsyncRead and AsyncWrite (see syscall.h) instead hand the
+//	transfer to a kernel thread of its own, and return a ticket at
+//	once; the program goes on running while the thread waits for the
+//	disk, and collects the result later with Wait, or checks on it
+//	with Poll.  Since each request has its own thread, a program can
+//	have several of them going at once, and the disk scheduler sees
+//	them all together.
+//
+//	The transfer is done in place, straight to or from the program's
+//	buffer, so the program must leave the buffer alone until the
+//	request is done.  Requests always give the position in the file
+//	to read or write at; they never use or move the seek position.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+
+#ifndef ASYNCIO_H
+#define ASYNCIO_H
+
+#include "filesys.h"
+
+class AddrSpace;
+class Semaphore;
+
+// The following class defines one asynchronous read or write.
+
+class AsyncRequest {
+  public:
+    AsyncRequest(AddrSpace *space, int buffer, int size, int position,
+				OpenFileId fileId, bool isWrite);
+					// Set up a request; it does not
+					// start until Start is called
+    ~AsyncRequest();			// De-allocate a request; it must be
+					// done
+
+    void Start();			// Fork the thread that does the
+					// transfer
+    void Transfer();			// Body of that thread
+    bool IsDone() { return done; }	// Is the transfer finished?
+    int Wait();				// Wait until it is, and return the
+					// number of bytes moved
+
+    OpenFileId GetFileId() { return fileId; }
+
+  private:
+    AddrSpace *space;			// Program whose buffer is used
+    int buffer;				// Virtual address of the buffer
+    int size;				// How many bytes to move
+    int position;			// Where in the file to start
+    OpenFileId fileId;			// Which file (an id from
+					// FileSystem::OpenFileForId)
+    bool writing;			// Is this a write?
+
+    bool done;				// Has the transfer finished?
+    int result;				// Bytes moved, once done
+    Semaphore *finished;		// Signalled when done
+};
+
+#endif // ASYNCIO_H
@@ -109,9 +109,8 @@ ExceptionHandler(ExceptionType which)
             {
                 int   size = (int) kernel->machine->ReadRegister(5);
                 OpenFileId f_id = (int) kernel->machine->ReadRegister(6);
-                char *buffer = &(kernel->machine->mainMemory[val]);
                 
-                status = SysWrite(buffer, size, f_id);
+                status = SysWrite(val, size, f_id);
                 kernel->machine->WriteRegister(2, (int) status);
             }
 			kernel->machine->WriteRegister(PrevPCReg, kernel->machine->ReadRegister(PCReg));
@@ -125,9 +124,8 @@ ExceptionHandler(ExceptionType which)
             {
                 int   size = (int) kernel->machine->ReadRegister(5);
                 OpenFileId f_id = (int) kernel->machine->ReadRegister(6);
-                char *buffer = &(kernel->machine->mainMemory[val]);
                 
-                status = SysRead(buffer, size, f_id);
+                status = SysRead(val, size, f_id);
                 kernel->machine->WriteRegister(2, (int) status);
             }
 			kernel->machine->WriteRegister(PrevPCReg, kernel->machine->ReadRegister(PCReg));
@@ -149,6 +147,148 @@ ExceptionHandler(ExceptionType which)
             return;
             ASSERTNOTREACHED();
             break;
+        case SC_Seek:
+            {
+                int   position = (int) kernel->machine->ReadRegister(4);
+                OpenFileId f_id = (int) kernel->machine->ReadRegister(5);
+
+                status = SysSeek(position, f_id);
+                kernel->machine->WriteRegister(2, (int) status);
+            }
+			kernel->machine->WriteRegister(PrevPCReg, kernel->machine->ReadRegister(PCReg));
+			kernel->machine->WriteRegister(PCReg, kernel->machine->ReadRegister(PCReg) + 4);
+			kernel->machine->WriteRegister(NextPCReg, kernel->machine->ReadRegister(PCReg)+4);
+            return;
+            ASSERTNOTREACHED();
+            break;
+        case SC_WriteAt:
+            val = kernel->machine->ReadRegister(4);
+            {
+                int   size = (int) kernel->machine->ReadRegister(5);
+                int   position = (int) kernel->machine->ReadRegister(6);
+                OpenFileId f_id = (int) kernel->machine->ReadRegister(7);
+
+                status = SysWriteAt(val, size, position, f_id);
+                kernel->machine->WriteRegister(2, (int) status);
+            }
+			kernel->machine->WriteRegister(PrevPCReg, kernel->machine->ReadRegister(PCReg));
+			kernel->machine->WriteRegister(PCReg, kernel->machine->ReadRegister(PCReg) + 4);
+			kernel->machine->WriteRegister(NextPCReg, kernel->machine->ReadRegister(PCReg)+4);
+            return;
+            ASSERTNOTREACHED();
+            break;
+        case SC_ReadAt:
+            val = kernel->machine->ReadRegister(4);
+            {
+                int   size = (int) kernel->machine->ReadRegister(5);
+                int   position = (int) kernel->machine->ReadRegister(6);
+                OpenFileId f_id = (int) kernel->machine->ReadRegister(7);
+
+                status = SysReadAt(val, size, position, f_id);
+                kernel->machine->WriteRegister(2, (int) status);
+            }
+			kernel->machine->WriteRegister(PrevPCReg, kernel->machine->ReadRegister(PCReg));
+			kernel->machine->WriteRegister(PCReg, kernel->machine->ReadRegister(PCReg) + 4);
+			kernel->machine->WriteRegister(NextPCReg, kernel->machine->ReadRegister(PCReg)+4);
+            return;
+            ASSERTNOTREACHED();
+            break;
+        case SC_AsyncWrite:
+            val = kernel->machine->ReadRegister(4);
+            {
+                int   size = (int) kernel->machine->ReadRegister(5);
+                int   position = (int) kernel->machine->ReadRegister(6);
+                OpenFileId f_id = (int) kernel->machine->ReadRegister(7);
+
+                status = SysAsyncWrite(val, size, position, f_id);
+                kernel->machine->WriteRegister(2, (int) status);
+            }
+			kernel->machine->WriteRegister(PrevPCReg, kernel->machine->ReadRegister(PCReg));
+			kernel->machine->WriteRegister(PCReg, kernel->machine->ReadRegister(PCReg) + 4);
+			kernel->machine->WriteRegister(NextPCReg, kernel->machine->ReadRegister(PCReg)+4);
+            return;
+            ASSERTNOTREACHED();
+            break;
+        case SC_AsyncRead:
+            val = kernel->machine->ReadRegister(4);
+            {
+                int   size = (int) kernel->machine->ReadRegister(5);
+                int   position = (int) kernel->machine->ReadRegister(6);
+                OpenFileId f_id = (int) kernel->machine->ReadRegister(7);
+
+                status = SysAsyncRead(val, size, position, f_id);
+                kernel->machine->WriteRegister(2, (int) status);
+            }
+			kernel->machine->WriteRegister(PrevPCReg, kernel->machine->ReadRegister(PCReg));
+			kernel->machine->WriteRegister(PCReg, kernel->machine->ReadRegister(PCReg) + 4);
+			kernel->machine->WriteRegister(NextPCReg, kernel->machine->ReadRegister(PCReg)+4);
+            return;
+            ASSERTNOTREACHED();
+            break;
+        case SC_Wait:
+            {
+                int   ticket = (int) kernel->machine->ReadRegister(4);
+
+                status = SysWait(ticket);
+                kernel->machine->WriteRegister(2, (int) status);
+            }
+			kernel->machine->WriteRegister(PrevPCReg, kernel->machine->ReadRegister(PCReg));
+			kernel->machine->WriteRegister(PCReg, kernel->machine->ReadRegister(PCReg) + 4);
+			kernel->machine->WriteRegister(NextPCReg, kernel->machine->ReadRegister(PCReg)+4);
+            return;
+            ASSERTNOTREACHED();
+            break;
+        case SC_Poll:
+            {
+                int   ticket = (int) kernel->machine->ReadRegister(4);
+
+                status = SysPoll(ticket);
+                kernel->machine->WriteRegister(2, (int) status);
+            }
+			kernel->machine->WriteRegister(PrevPCReg, kernel->machine->ReadRegister(PCReg));
+			kernel->machine->WriteRegister(PCReg, kernel->machine->ReadRegister(PCReg) + 4);
+			kernel->machine->WriteRegister(NextPCReg, kernel->machine->ReadRegister(PCReg)+4);
+            return;
+            ASSERTNOTREACHED();
+            break;
+        case SC_WriteV:
+            {
+                int   iov = (int) kernel->machine->ReadRegister(4);
+                int   count = (int) kernel->machine->ReadRegister(5);
+                OpenFileId f_id = (int) kernel->machine->ReadRegister(6);
+
+                status = SysWriteV(iov, count, f_id);
+                kernel->machine->WriteRegister(2, (int) status);
+            }
+			kernel->machine->WriteRegister(PrevPCReg, kernel->machine->ReadRegister(PCReg));
+			kernel->machine->WriteRegister(PCReg, kernel->machine->ReadRegister(PCReg) + 4);
+			kernel->machine->WriteRegister(NextPCReg, kernel->machine->ReadRegister(PCReg)+4);
+            return;
+            ASSERTNOTREACHED();
+            break;
+        case SC_ReadV:
+            {
+                int   iov = (int) kernel->machine->ReadRegister(4);
+                int   count = (int) kernel->machine->ReadRegister(5);
+                OpenFileId f_id = (int) kernel->machine->ReadRegister(6);
+
+                status = SysReadV(iov, count, f_id);
+                kernel->machine->WriteRegister(2, (int) status);
+            }
+			kernel->machine->WriteRegister(PrevPCReg, kernel->machine->ReadRegister(PCReg));
+			kernel->machine->WriteRegister(PCReg, kernel->machine->ReadRegister(PCReg) + 4);
+			kernel->machine->WriteRegister(NextPCReg, kernel->machine->ReadRegister(PCReg)+4);
+            return;
+            ASSERTNOTREACHED();
+            break;
+        case SC_Sync:
+            SysSync();
+            kernel->machine->WriteRegister(PrevPCReg, kernel->machine->ReadRegister(PCReg));
+			kernel->machine->WriteRegister(PCReg, kernel->machine->ReadRegister(PCReg) + 4);
+			kernel->machine->WriteRegister(NextPCReg, kernel->machine->ReadRegister(PCReg)+4);
+            return;
+            ASSERTNOTREACHED();
+            break;
       	case SC_Add:
 			DEBUG(dbgSys, "Add " << kernel->machine->ReadRegister(4) << " + " << kernel->machine->ReadRegister(5) << "\n");
 			/* Process SysAdd Systemcall*/
@@ -177,6 +317,7 @@ ExceptionHandler(ExceptionType which)
 			DEBUG(dbgAddr, "Program exit\n");
             val=kernel->machine->ReadRegister(4);
             cout << "return value:" << val << endl;
+            kernel->currentThread->space->CloseFiles();
 			kernel->currentThread->Finish();
             break;
       	default:
@@ -14,6 +14,7 @@
 #include "kernel.h"
 
 #include "synchconsole.h"
+#include "asyncio.h"
 
 
 void SysHalt()
@@ -43,24 +44,276 @@ int SysCreate(char *filename, int size)
 	return kernel->interrupt->CreateFile(filename, size);
 }
 
+// The ids user programs pass are descriptors of their own address
+// space; each is turned into the id of the file in the file system's
+// table of open files before it goes any further.
+
 OpenFileId SysOpen(char *filename)
 {
-    return kernel->interrupt->OpenFile(filename);
+    AddrSpace *space = kernel->currentThread->space;
+    OpenFileId fileId = kernel->interrupt->OpenFile(filename);
+    OpenFileId fd;
+
+    if (fileId == -1)
+        return -1;
+    fd = space->AllocFd(fileId);
+    if (fd == -1)
+        kernel->interrupt->CloseFileId(fileId);	// no descriptor free
+    return fd;
+}
+
+int SysWrite(int buffer, int size, OpenFileId id) 
+{
+    OpenFileId fileId = kernel->currentThread->space->LookupFd(id);
+
+    if (fileId == -1)
+        return -1;
+    return kernel->currentThread->space->WriteFile(buffer, size, -1, fileId);
+}
+
+int SysRead(int buffer, int size, OpenFileId id)
+{
+    OpenFileId fileId = kernel->currentThread->space->LookupFd(id);
+
+    if (fileId == -1)
+        return -1;
+    return kernel->currentThread->space->ReadFile(buffer, size, -1, fileId);
+}
+
+// WriteAt/ReadAt name the position in the file outright, and leave
+// the seek position alone, so that programs doing random I/O on a
+// file need not Seek before each access.
+
+int SysWriteAt(int buffer, int size, int position, OpenFileId id) 
+{
+    OpenFileId fileId = kernel->currentThread->space->LookupFd(id);
+
+    if (fileId == -1 || position < 0)
+        return -1;
+    return kernel->currentThread->space->WriteFile(buffer, size, position,
+                                                                fileId);
+}
+
+int SysReadAt(int buffer, int size, int position, OpenFileId id)
+{
+    OpenFileId fileId = kernel->currentThread->space->LookupFd(id);
+
+    if (fileId == -1 || position < 0)
+        return -1;
+    return kernel->currentThread->space->ReadFile(buffer, size, position,
+                                                                fileId);
+}
+
+int SysSeek(int position, OpenFileId id)
+{
+    OpenFileId fileId = kernel->currentThread->space->LookupFd(id);
+
+    if (fileId == -1)
+        return -1;
+    return kernel->interrupt->SeekFileId(position, fileId);
+}
+
+// ReadV/WriteV move a list of user buffers (an IOVec array, see
+// syscall.h) with one system call.  Small buffers are gathered into,
+// or scattered from, a staging buffer in the kernel, so that a run of
+// them costs one file system read or write rather than one each, and
+// one read-modify-write of a sector rather than dozens.  Buffers of
+// IOStageSize bytes or more are read or written in place.
+
+#define IOStageSize	256	// most bytes ReadV/WriteV stage at once
+
+// Copy "size" bytes from the user buffer at "vaddr" into "data"
+// (mode 0), or from "data" out to the user buffer (mode 1).
+// Return FALSE if the user buffer is not a legal address.
+
+bool CopyUser(int vaddr, char *data, int size, int mode)
+{
+    AddrSpace *space = kernel->currentThread->space;
+    int done = 0, length;
+    char *user;
+
+    while (done < size) {
+        user = space->UserBuffer(vaddr + done, size - done, mode, &length);
+        if (user == NULL)
+            return FALSE;
+        if (mode == 0)
+            bcopy(user, &data[done], length);
+        else
+            bcopy(&data[done], user, length);
+        done += length;
+    }
+    return TRUE;
+}
+
+// Fetch the "i"th entry of the user's IOVec array at "iov".
+
+bool GetIOVec(int iov, int i, int *base, int *size)
+{
+    int vec[2];
+
+    if (!CopyUser(iov + i * sizeof(vec), (char *) vec, sizeof(vec), 0))
+        return FALSE;
+    *base = WordToHost(vec[0]);
+    *size = WordToHost(vec[1]);
+    return (*size >= 0);
+}
+
+int SysWriteV(int iov, int count, OpenFileId id)
+{
+    OpenFileId fileId = kernel->currentThread->space->LookupFd(id);
+    char stage[IOStageSize];
+    int done = 0, i = 0, first, base, size, length, written;
+
+    if (fileId == -1)
+        return -1;
+    while (i < count) {
+        if (!GetIOVec(iov, i, &base, &size))
+            break;
+        if (size >= IOStageSize) {	// big enough to write in place
+            written = kernel->currentThread->space->WriteFile(base, size,
+                                                            -1, fileId);
+            done += written;
+            i++;
+            if (written < size)
+                break;
+            continue;
+        }
+
+        // gather as many small buffers as fit, and write them at once
+        first = i;
+        length = 0;
+        while (i < count && GetIOVec(iov, i, &base, &size)
+                && length + size <= IOStageSize
+                && CopyUser(base, &stage[length], size, 0)) {
+            length += size;
+            i++;
+        }
+        if (i == first)
+            break;			// bad address
+        written = kernel->interrupt->WriteToFileId(stage, length, fileId);
+        done += written;
+        if (written < length)
+            break;			// disk full
+    }
+    return done;
+}
+
+int SysReadV(int iov, int count, OpenFileId id)
+{
+    OpenFileId fileId = kernel->currentThread->space->LookupFd(id);
+    char stage[IOStageSize];
+    int done = 0, i = 0, first, base, size, length, read, offset;
+
+    if (fileId == -1)
+        return -1;
+    while (i < count) {
+        if (!GetIOVec(iov, i, &base, &size))
+            break;
+        if (size >= IOStageSize) {	// big enough to read in place
+            read = kernel->currentThread->space->ReadFile(base, size,
+                                                            -1, fileId);
+            done += read;
+            i++;
+            if (read < size)
+                break;
+            continue;
+        }
+
+        // read for as many small buffers as fit at once, then scatter
+        first = i;
+        length = 0;
+        while (i < count && GetIOVec(iov, i, &base, &size)
+                && length + size <= IOStageSize) {
+            length += size;
+            i++;
+        }
+        read = kernel->interrupt->ReadFromFileId(stage, length, fileId);
+        for (offset = 0; first < i && offset < read; first++) {
+            GetIOVec(iov, first, &base, &size);
+            size = min(size, read - offset);
+            if (!CopyUser(base, &stage[offset], size, 1))
+                return done + offset;	// bad address
+            offset += size;
+        }
+        done += read;
+        if (read < length)
+            break;			// end of file
+    }
+    return done;
 }
 
-int SysWrite(char *buffer, int size, OpenFileId id) 
+// AsyncRead/AsyncWrite start a transfer and return a ticket for it at
+// once; Wait and Poll collect it (see asyncio.h).
+
+int SysAsyncIO(int buffer, int size, int position, OpenFileId id,
+                                                        bool writing)
 {
-    return kernel->interrupt->WriteToFileId(buffer, size, id);
+    AddrSpace *space = kernel->currentThread->space;
+    OpenFileId fileId = space->LookupFd(id);
+    AsyncRequest *request;
+    int ticket;
+
+    if (fileId == -1 || position < 0 || size < 0)
+        return -1;
+    request = new AsyncRequest(space, buffer, size, position, fileId,
+                                                        writing);
+    ticket = space->AddRequest(request);
+    if (ticket == -1) {
+        delete request;			// too many outstanding
+        return -1;
+    }
+    request->Start();
+    return ticket;
 }
 
-int SysRead(char *buffer, int size, OpenFileId id)
+int SysAsyncWrite(int buffer, int size, int position, OpenFileId id)
 {
-    return kernel->interrupt->ReadFromFileId(buffer, size, id);
+    return SysAsyncIO(buffer, size, position, id, TRUE);
+}
+
+int SysAsyncRead(int buffer, int size, int position, OpenFileId id)
+{
+    return SysAsyncIO(buffer, size, position, id, FALSE);
+}
+
+int SysWait(int ticket)
+{
+    AddrSpace *space = kernel->currentThread->space;
+    AsyncRequest *request = space->LookupRequest(ticket);
+    int result;
+
+    if (request == NULL)
+        return -1;
+    result = request->Wait();
+    space->RemoveRequest(ticket);
+    delete request;
+    return result;
+}
+
+int SysPoll(int ticket)
+{
+    AsyncRequest *request = kernel->currentThread->space->LookupRequest(ticket);
+
+    if (request == NULL)
+        return -1;
+    return request->IsDone() ? 1 : 0;
 }
 
 int SysClose(OpenFileId id)
 {
-    return kernel->interrupt->CloseFileId(id);
+    AddrSpace *space = kernel->currentThread->space;
+    OpenFileId fileId = space->LookupFd(id);
+
+    if (fileId == -1)
+        return -1;			// not open
+    space->WaitRequests(fileId);	// async I/O must finish first
+    space->FreeFd(id);
+    return kernel->interrupt->CloseFileId(fileId);
+}
+
+void SysSync()
+{
+    kernel->interrupt->Sync();
 }
 
 
@@ -34,6 +34,15 @@
 #define SC_ExecV	13
 #define SC_ThreadExit   14
 #define SC_ThreadJoin   15
+#define SC_Sync		16
+#define SC_ReadV	17
+#define SC_WriteV	18
+#define SC_ReadAt	19
+#define SC_WriteAt	20
+#define SC_AsyncRead	21
+#define SC_AsyncWrite	22
+#define SC_Wait		23
+#define SC_Poll		24
 #define SC_Add		42
 #define SC_MSG		100
 
@@ -138,16 +147,80 @@ int Write(char *buffer, int size, OpenFileId id);
  */
 int Read(char *buffer, int size, OpenFileId id);
 
+/* One buffer for ReadV/WriteV: "len" bytes starting at "buf". */
+typedef struct {
+    char *buf;
+    int len;
+} IOVec;
+
+/* Write the "count" buffers described by "iov" to the open file, one
+ * after another, as if by that many Writes, but with one system call.
+ * Return the number of bytes actually written.
+ */
+int WriteV(IOVec *iov, int count, OpenFileId id);
+
+/* Read from the open file into the "count" buffers described by "iov",
+ * filling each before going on to the next.  Return the number of bytes
+ * actually read.
+ */
+int ReadV(IOVec *iov, int count, OpenFileId id);
+
 /* Set the seek position of the open file "id"
  * to the byte "position".
+ * Return 1 on success, negative error code on failure.
  */
 int Seek(int position, OpenFileId id);
 
+/* Write "size" bytes from "buffer" to the open file, starting at the
+ * byte "position", rather than at the seek position, which is left
+ * alone.  Return the number of bytes actually written.
+ */
+int WriteAt(char *buffer, int size, int position, OpenFileId id);
+
+/* Read "size" bytes from the open file into "buffer", starting at the
+ * byte "position", rather than at the seek position, which is left
+ * alone.  Return the number of bytes actually read.
+ */
+int ReadAt(char *buffer, int size, int position, OpenFileId id);
+
+/* Start writing "size" bytes from "buffer" to the open file, at the
+ * byte "position", and return at once, without waiting for the disk.
+ * Return a ticket for the write, to pass to Wait or Poll, or a
+ * negative error code.  "buffer" must be left alone until the write
+ * is done.
+ */
+int AsyncWrite(char *buffer, int size, int position, OpenFileId id);
+
+/* Start reading "size" bytes from the open file into "buffer", at the
+ * byte "position", and return at once, without waiting for the disk.
+ * Return a ticket for the read, to pass to Wait or Poll, or a
+ * negative error code.  "buffer" holds the data once the read is done.
+ */
+int AsyncRead(char *buffer, int size, int position, OpenFileId id);
+
+/* Wait until the AsyncRead or AsyncWrite "ticket" is done, and return
+ * the number of bytes actually read or written.  The ticket is then
+ * free to be handed out again.  Return -1 if "ticket" is not in use.
+ */
+int Wait(int ticket);
+
+/* Return 1 if the AsyncRead or AsyncWrite "ticket" is done (so that
+ * Wait will not block), 0 if it is still going on, and -1 if "ticket"
+ * is not in use.
+ */
+int Poll(int ticket);
+
 /* Close the file, we're done reading and writing to it.
  * Return 1 on success, negative error code on failure
  */
 int Close(OpenFileId id);
 
+/* Write any file system data still held in kernel memory back to
+ * the disk.  Only has an effect when Nachos runs with write-back
+ * disk caching (-wb).
+ */
+void Sync();
+
 
 /* User-level thread operations: Fork and Yield.  To allow multiple
  * threads to run within a user program. 